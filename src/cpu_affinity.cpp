@@ -0,0 +1,86 @@
+#include "cpu_affinity.hpp"
+
+#include <sched.h>
+#include <cstring>
+#include <cerrno>
+#include <fstream>
+#include <sstream>
+
+std::vector<int> parseCpuList(const std::string &list) {
+    std::vector<int> cpus;
+    std::istringstream iss(list);
+    std::string range;
+    while (std::getline(iss, range, ',')) {
+        // Trim whitespace and trailing newline (sysfs files end with '\n')
+        range.erase(0, range.find_first_not_of(" \t\n"));
+        range.erase(range.find_last_not_of(" \t\n") + 1);
+        if (range.empty()) continue;
+
+        try {
+            size_t idx;
+            size_t dash = range.find('-');
+            int first = std::stoi(range.substr(0, dash), &idx);
+            if (idx != (dash == std::string::npos ? range.size() : dash)) throw std::invalid_argument(range);
+            int last = first;
+            if (dash != std::string::npos) {
+                std::string tail = range.substr(dash + 1);
+                last = std::stoi(tail, &idx);
+                if (idx != tail.size()) throw std::invalid_argument(range);
+            }
+            if (first < 0 || last < first || last >= CPU_SETSIZE) throw std::invalid_argument(range);
+            for (int cpu = first; cpu <= last; ++cpu) cpus.push_back(cpu);
+        } catch (const std::exception&) {
+            throw std::invalid_argument("Invalid CPU list entry '" + range + "'");
+        }
+    }
+    return cpus;
+}
+
+std::vector<int> getNumaNodeCpus(int node) {
+    std::string path = "/sys/devices/system/node/node" + std::to_string(node) + "/cpulist";
+    std::ifstream in(path);
+    if (!in) {
+        throw std::runtime_error("NUMA node " + std::to_string(node) + " not found (" + path + ")");
+    }
+    std::string line;
+    std::getline(in, line);
+    return parseCpuList(line);
+}
+
+void pinCurrentThread(const std::vector<int> &cpus) {
+    if (cpus.empty()) throw std::invalid_argument("CPU set cannot be empty");
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) {
+        if (cpu < 0 || cpu >= CPU_SETSIZE) {
+            throw std::invalid_argument("CPU number out of range: " + std::to_string(cpu));
+        }
+        CPU_SET(cpu, &set);
+    }
+    // pid 0 applies to the calling thread only
+    if (sched_setaffinity(0, sizeof(set), &set) == -1) {
+        throw std::runtime_error("Failed to set CPU affinity: " + std::string(strerror(errno)));
+    }
+}
+
+std::vector<int> getCurrentAffinity() {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == -1) {
+        throw std::runtime_error("Failed to get CPU affinity: " + std::string(strerror(errno)));
+    }
+    std::vector<int> cpus;
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (CPU_ISSET(cpu, &set)) cpus.push_back(cpu);
+    }
+    return cpus;
+}
+
+void pinCurrentThreadToNode(int node) {
+    pinCurrentThread(getNumaNodeCpus(node));
+}
+
+int getCurrentCpu() {
+    return sched_getcpu();
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+// Helpers for pinning consumer/producer threads to CPUs or NUMA nodes (Linux only).
+// NUMA topology is read from sysfs, so no libnuma dependency is required.
+
+// Parse a CPU list such as "0-3,8,10-11" into individual CPU numbers.
+// Throws std::invalid_argument on malformed input
+std::vector<int> parseCpuList(const std::string &list);
+
+// Get the CPUs belonging to a NUMA node (from /sys/devices/system/node/node<N>/cpulist).
+// Throws std::runtime_error if the node does not exist
+std::vector<int> getNumaNodeCpus(int node);
+
+// Pin the calling thread to the given set of CPUs.
+// Throws std::invalid_argument on an empty set, std::runtime_error on failure
+void pinCurrentThread(const std::vector<int> &cpus);
+
+// Get the CPUs the calling thread is currently allowed to run on.
+// Throws std::runtime_error on failure
+std::vector<int> getCurrentAffinity();
+
+// Pin the calling thread to all CPUs of a NUMA node.
+// Throws std::runtime_error on failure
+void pinCurrentThreadToNode(int node);
+
+// Get the CPU the calling thread is currently running on, or -1 if unknown
+int getCurrentCpu();
@@ -0,0 +1,103 @@
+#include "ipc_internal.hpp"
+
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <chrono>
+#include <thread>
+#include <string>
+#include <stdexcept>
+#include <cstring>
+#include <cerrno>
+
+uint64_t monotonicNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int64_t monotonicMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+uint64_t mix64(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+static void *attach_shmid(int shmid, const char *what) {
+    void *addr = shmat(shmid, nullptr, 0);
+    if (addr == reinterpret_cast<void *>(-1)) {
+        throw std::runtime_error("Failed to attach " + std::string(what) + " shared memory: " + std::string(strerror(errno)));
+    }
+    return addr;
+}
+
+void *createSegment(key_t key, size_t size, unsigned short permissions, const char *what, int &shmid) {
+    shmid = shmget(key, size, IPC_CREAT | IPC_EXCL | permissions);
+    if (shmid == -1 && errno == EEXIST) return nullptr;
+    if (shmid == -1) {
+        throw std::runtime_error("Failed to create " + std::string(what) + " shared memory: " + std::string(strerror(errno)));
+    }
+    return attach_shmid(shmid, what);
+}
+
+void publishSegment(void *addr, uint32_t magic, uint64_t num_slots) {
+    ShmSegmentHeader *hdr = static_cast<ShmSegmentHeader *>(addr);
+    hdr->magic = magic;
+    hdr->num_slots = num_slots;
+    hdr->ready.store(1, std::memory_order_release);
+}
+
+void *attachSegment(key_t key, uint32_t magic, size_t header_size, size_t slot_size, const char *what, int &shmid,
+                    uint64_t &num_slots) {
+    shmid = shmget(key, 0, 0);
+    if (shmid == -1) {
+        throw std::runtime_error("Failed to find " + std::string(what) + " shared memory: " + std::string(strerror(errno)));
+    }
+    struct shmid_ds buf;
+    if (shmctl(shmid, IPC_STAT, &buf) == -1) {
+        throw std::runtime_error("Failed to get " + std::string(what) + " shared memory info: " + std::string(strerror(errno)));
+    }
+    size_t segment_size = buf.shm_segsz;
+    if (segment_size < header_size) {
+        throw std::runtime_error("Shared memory segment is too small for a " + std::string(what));
+    }
+    void *addr = attach_shmid(shmid, what);
+
+    // Wait for the creator to finish initializing the table
+    ShmSegmentHeader *hdr = static_cast<ShmSegmentHeader *>(addr);
+    for (int i = 0; hdr->ready.load(std::memory_order_acquire) == 0; ++i) {
+        if (i > 1000) {
+            shmdt(addr);
+            throw std::runtime_error("Shared memory segment of the " + std::string(what) + " was never initialized");
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    if (hdr->magic != magic) {
+        shmdt(addr);
+        throw std::runtime_error("Shared memory segment is not a " + std::string(what));
+    }
+    // Read the slot count once: it is checked here and then only used from the caller's copy
+    uint64_t n = hdr->num_slots;
+    bool fits = slot_size ? n <= (segment_size - header_size) / slot_size : n == 0;
+    if (!fits) {
+        shmdt(addr);
+        throw std::runtime_error("Shared memory segment is smaller than the " + std::string(what) + " it declares");
+    }
+    num_slots = n;
+    return addr;
+}
+
+void detachSegment(void *addr) {
+    if (addr) shmdt(addr);
+}
+
+void removeSegment(int shmid, const char *what) {
+    if (shmctl(shmid, IPC_RMID, nullptr) == -1) {
+        throw std::runtime_error("Failed to remove " + std::string(what) + " shared memory: " + std::string(strerror(errno)));
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <sys/types.h>
+
+// Helpers shared by the library's translation units. Not part of the public API.
+
+// CLOCK_MONOTONIC time. The clock is system-wide, so values are comparable across processes.
+uint64_t monotonicNs();
+int64_t monotonicMs();
+
+// splitmix64 finalizer: spreads sequential 64-bit keys evenly over buckets or shards
+uint64_t mix64(uint64_t x);
+
+// Every shared memory table of the library starts with this header, followed by the rest of
+// the table's own header and num_slots fixed-size slots
+struct ShmSegmentHeader {
+    std::atomic<uint32_t> ready;   // Set by the creator once the table is initialized
+    uint32_t magic;                // Identifies the kind of table
+    uint64_t num_slots;            // Number of slots after the table header
+};
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "shared header fields must be lock-free");
+
+// Create a zero-filled segment of size bytes for key and attach to it.
+// Returns nullptr if a segment with this key already exists.
+// The caller initializes its table, then calls publishSegment.
+// Throws std::runtime_error on failure (what names the table in error messages)
+void *createSegment(key_t key, size_t size, unsigned short permissions, const char *what, int &shmid);
+
+// Mark a segment created by createSegment as initialized, with num_slots slots
+void publishSegment(void *addr, uint32_t magic, uint64_t num_slots);
+
+// Attach to an existing segment, waiting for its creator to publish it. Sets num_slots to the
+// table's slot count once the segment is known to be large enough for header_size bytes plus
+// num_slots slots of slot_size bytes: the header may have been written by any process with
+// access, so callers keep this validated count instead of reading it from the segment again.
+// Throws std::runtime_error on failure, if the segment holds a different kind of table or if
+// it is smaller than the table it declares
+void *attachSegment(key_t key, uint32_t magic, size_t header_size, size_t slot_size, const char *what, int &shmid,
+                    uint64_t &num_slots);
+
+// Detach from a segment (nullptr is ignored)
+void detachSegment(void *addr);
+
+// Remove a segment. Attached processes keep their mapping until they detach.
+// Throws std::runtime_error on failure
+void removeSegment(int shmid, const char *what);
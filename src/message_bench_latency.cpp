@@ -0,0 +1,295 @@
+#include "message_queue.hpp"
+#include "cpu_affinity.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <csignal>
+#include <cstring>
+#include <cerrno>
+#include <sys/ipc.h>
+#include <sys/msg.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Ping-pong wake-up latency benchmark.
+// A forked consumer echoes every ping (type 1) back as a pong (type 2); the producer
+// measures the round trip. Each configuration (pinning x spin budget) runs on a fresh
+// private queue so results do not interfere with each other.
+
+static const long PING_TYPE = 1;
+static const long PONG_TYPE = 2;
+static const char QUIT_MARK = 'q';
+static const char ABORT_MARK = 'x';   // Pong posted when the consumer exits (pings are all 'p')
+
+// Queue of the running configuration, for the SIGCHLD handler
+static volatile sig_atomic_t g_msqid = -1;
+
+// A consumer that exits early would leave the producer blocked on its pong forever. Post an
+// abort pong instead: msgsnd is a plain system call, and the queue never holds more than one
+// message, so the send does not block. Unlike a flag, the pong cannot be missed by a producer
+// that is just about to block.
+static void on_child_exit(int) {
+    int saved_errno = errno;
+    struct {
+        long mtype;
+        char mtext[1];
+    } msg = {PONG_TYPE, {ABORT_MARK}};
+    if (g_msqid != -1) msgsnd(g_msqid, &msg, sizeof(msg.mtext), IPC_NOWAIT);
+    errno = saved_errno;
+}
+
+struct PinConfig {
+    std::string name;
+    std::vector<int> producer_cpus;  // empty = the mask the benchmark started with
+    std::vector<int> consumer_cpus;  // empty = the mask the benchmark started with
+};
+
+struct LatencyStats {
+    double min_us;
+    double p50_us;
+    double p90_us;
+    double p99_us;
+    double max_us;
+    double mean_us;
+};
+
+bool parse_size_t(const std::string& s, size_t& value) {
+    try {
+        size_t idx;
+        value = std::stoull(s, &idx, 0);
+        return idx == s.size();
+    } catch (...) {
+        return false;
+    }
+}
+
+bool parse_int(const std::string& s, int& value) {
+    try {
+        size_t idx;
+        long v = std::stol(s, &idx, 0);
+        if (idx != s.size() || v < 0) return false;
+        value = static_cast<int>(v);
+        return true;
+    } catch (...) {
+        return false;
+    }
+}
+
+bool parse_spin_list(const std::string& s, std::vector<unsigned int>& values) {
+    std::istringstream iss(s);
+    std::string token;
+    values.clear();
+    while (std::getline(iss, token, ',')) {
+        size_t v = 0;
+        if (!parse_size_t(token, v) || v > 1000000) return false;
+        values.push_back(static_cast<unsigned int>(v));
+    }
+    return !values.empty();
+}
+
+void print_usage() {
+    std::cout << "Usage: message_bench_latency [options]\n"
+              << "  --iterations <n>        : round trips per configuration (default: 10000)\n"
+              << "  --size <bytes>          : payload size (default: 64)\n"
+              << "  --spin <us[,us...]>     : spin budgets to compare in microseconds (default: 0,10,100)\n"
+              << "  --producer-cpus <list>  : CPU list for the producer, e.g. 0 or 0-3\n"
+              << "  --consumer-cpus <list>  : CPU list for the consumer\n"
+              << "  --numa <node>           : pin both producer and consumer to a NUMA node\n"
+              << "  Configurations are always compared against an unpinned baseline.\n";
+}
+
+LatencyStats compute_stats(std::vector<double>& samples) {
+    std::sort(samples.begin(), samples.end());
+    auto pct = [&](double p) {
+        size_t idx = static_cast<size_t>(p * (samples.size() - 1));
+        return samples[idx];
+    };
+    double sum = 0;
+    for (double s : samples) sum += s;
+
+    LatencyStats st;
+    st.min_us = samples.front();
+    st.p50_us = pct(0.50);
+    st.p90_us = pct(0.90);
+    st.p99_us = pct(0.99);
+    st.max_us = samples.back();
+    st.mean_us = sum / samples.size();
+    return st;
+}
+
+// Consumer side: echo pings until the quit marker arrives. Runs in the child process.
+// Always pins, since the child would otherwise inherit whatever mask the parent had at fork.
+[[noreturn]] void run_consumer(int msqid, const std::vector<int>& cpus, unsigned int spin_us) {
+    try {
+        pinCurrentThread(cpus);
+        for (;;) {
+            std::string msg = MessageQueue::receiveMessageSpin(msqid, PING_TYPE, spin_us);
+            if (msg[0] == QUIT_MARK) break;
+            MessageQueue::sendMessage(msqid, PONG_TYPE, msg);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Consumer failed: " << e.what() << "\n";
+        _exit(1);
+    }
+    _exit(0);
+}
+
+// Producer side: returns one-way latency samples (round trip / 2) in microseconds
+std::vector<double> run_producer(int msqid, const std::vector<int>& cpus, unsigned int spin_us,
+                                 size_t iterations, size_t size) {
+    pinCurrentThread(cpus);
+
+    std::string payload(size, 'p');
+    std::vector<double> samples;
+    samples.reserve(iterations);
+
+    size_t warmup = std::min<size_t>(iterations / 10, 1000);
+    for (size_t i = 0; i < warmup + iterations; ++i) {
+        auto t0 = std::chrono::steady_clock::now();
+        MessageQueue::sendMessage(msqid, PING_TYPE, payload);
+        std::string pong;
+        do {
+            // The handler's msgsnd can also interrupt our own blocking receive
+            try {
+                pong = MessageQueue::receiveMessageSpin(msqid, PONG_TYPE, spin_us);
+            } catch (const std::runtime_error& e) {
+                if (std::string(e.what()).find(strerror(EINTR)) == std::string::npos) throw;
+            }
+        } while (pong.empty());
+        if (pong[0] == ABORT_MARK) throw std::runtime_error("consumer exited without answering");
+        auto t1 = std::chrono::steady_clock::now();
+        if (i >= warmup) {
+            samples.push_back(std::chrono::duration<double, std::micro>(t1 - t0).count() / 2.0);
+        }
+    }
+    MessageQueue::sendMessage(msqid, PING_TYPE, std::string(1, QUIT_MARK));
+    return samples;
+}
+
+int main(int argc, char* argv[]) {
+    size_t iterations = 10000;
+    size_t size = 64;
+    std::vector<unsigned int> spins = {0, 10, 100};
+    PinConfig pinned{"pinned", {}, {}};
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        try {
+            if (arg == "--iterations" && has_value) {
+                if (!parse_size_t(argv[++i], iterations) || iterations == 0) throw std::invalid_argument("iterations");
+            } else if (arg == "--size" && has_value) {
+                if (!parse_size_t(argv[++i], size) || size == 0) throw std::invalid_argument("size");
+            } else if (arg == "--spin" && has_value) {
+                if (!parse_spin_list(argv[++i], spins)) throw std::invalid_argument("spin");
+            } else if (arg == "--producer-cpus" && has_value) {
+                pinned.producer_cpus = parseCpuList(argv[++i]);
+            } else if (arg == "--consumer-cpus" && has_value) {
+                pinned.consumer_cpus = parseCpuList(argv[++i]);
+            } else if (arg == "--numa" && has_value) {
+                int node = -1;
+                if (!parse_int(argv[++i], node)) throw std::invalid_argument("numa");
+                pinned.name = "numa" + std::to_string(node);
+                pinned.producer_cpus = getNumaNodeCpus(node);
+                pinned.consumer_cpus = pinned.producer_cpus;
+            } else {
+                print_usage();
+                return arg == "--help" || arg == "-h" ? 0 : 1;
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "Error: Invalid value for " << arg << " (" << e.what() << ").\n";
+            print_usage();
+            return 1;
+        }
+    }
+
+    std::vector<PinConfig> configs = {{"unpinned", {}, {}}};
+    if (!pinned.producer_cpus.empty() || !pinned.consumer_cpus.empty()) configs.push_back(pinned);
+
+    // "Unpinned" means the mask the benchmark started with; each side is pinned to it when it
+    // has no CPU set of its own, so no run inherits the previous run's producer pinning
+    std::vector<int> all_cpus;
+    try {
+        all_cpus = getCurrentAffinity();
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+    for (PinConfig& cfg : configs) {
+        if (cfg.producer_cpus.empty()) cfg.producer_cpus = all_cpus;
+        if (cfg.consumer_cpus.empty()) cfg.consumer_cpus = all_cpus;
+        // Check the CPU sets up front: a side that cannot pin would only fail after the fork
+        for (const std::vector<int>* cpus : {&cfg.producer_cpus, &cfg.consumer_cpus}) {
+            for (int cpu : *cpus) {
+                if (std::find(all_cpus.begin(), all_cpus.end(), cpu) == all_cpus.end()) {
+                    std::cerr << "Error: CPU " << cpu << " is not available to this process ("
+                              << (cpus == &cfg.producer_cpus ? "producer" : "consumer") << " CPUs of "
+                              << cfg.name << ").\n";
+                    return 1;
+                }
+            }
+        }
+    }
+
+    struct sigaction sa = {};
+    sa.sa_handler = on_child_exit;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = SA_NOCLDSTOP;
+    sigaction(SIGCHLD, &sa, nullptr);
+
+    std::cout << "One-way latency (round trip / 2) in microseconds, "
+              << iterations << " iterations, " << size << " byte payload\n";
+    std::cout << std::left << std::setw(12) << "pinning" << std::right
+              << std::setw(10) << "spin_us" << std::setw(10) << "min" << std::setw(10) << "p50"
+              << std::setw(10) << "p90" << std::setw(10) << "p99" << std::setw(10) << "max"
+              << std::setw(10) << "mean" << "\n";
+    std::cout << std::fixed << std::setprecision(2);
+
+    for (const PinConfig& cfg : configs) {
+        for (unsigned int spin_us : spins) {
+            int msqid = -1;
+            pid_t pid = -1;
+            try {
+                MessageQueue mq = MessageQueue::create(IPC_PRIVATE, 16384);
+                msqid = mq.getMsqid();
+                g_msqid = msqid;
+
+                pid = fork();
+                if (pid == -1) throw std::runtime_error("fork failed");
+                if (pid == 0) run_consumer(msqid, cfg.consumer_cpus, spin_us);
+
+                std::vector<double> samples = run_producer(msqid, cfg.producer_cpus, spin_us, iterations, size);
+                int status = 0;
+                waitpid(pid, &status, 0);
+                pid = -1;
+                g_msqid = -1;
+                mq.remove();
+                msqid = -1;
+                if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) throw std::runtime_error("consumer exited abnormally");
+
+                LatencyStats st = compute_stats(samples);
+                std::cout << std::left << std::setw(12) << cfg.name << std::right
+                          << std::setw(10) << spin_us << std::setw(10) << st.min_us << std::setw(10) << st.p50_us
+                          << std::setw(10) << st.p90_us << std::setw(10) << st.p99_us << std::setw(10) << st.max_us
+                          << std::setw(10) << st.mean_us << "\n";
+            } catch (const std::exception& e) {
+                // Removing the queue also makes a consumer that is still running exit
+                g_msqid = -1;
+                if (msqid != -1) {
+                    try { MessageQueue::remove(msqid); } catch (...) {}
+                }
+                if (pid > 0) waitpid(pid, nullptr, 0);
+                std::cerr << "Benchmark failed (" << cfg.name << ", spin " << spin_us << "): " << e.what() << "\n";
+                return 1;
+            }
+        }
+    }
+
+    return 0;
+}
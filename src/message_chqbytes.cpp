@@ -1,9 +1,11 @@
 #include "message_queue.hpp"
+#include "sharded_queue.hpp"
 
 #include <iostream>
 #include <string>
 #include <limits>
 #include <cstdlib>
+#include <vector>
 
 bool parse_int(const std::string& s, int& value) {
     try {
@@ -29,16 +31,19 @@ bool parse_size_t(const std::string& s, size_t& value) {
 
 void print_usage() {
     std::cout << "Usage: message_chqbytes <msqid> <max_bytes>\n"
-              << "  <msqid>    : message queue ID\n"
-              << "  <max_bytes>: new maximum allowed bytes in queue\n";
+              << "  <msqid>    : message queue ID, or shard:<base_key>:<count> to resize every shard\n"
+              << "  <max_bytes>: new maximum allowed bytes in queue (per shard)\n";
 }
 
 int main(int argc, char* argv[]) {
     int msqid = -1;
     size_t max_bytes = 0;
+    std::string spec;
 
     if (argc >= 3) {
-        if (!parse_int(argv[1], msqid)) {
+        if (ShardedQueue::isSpec(argv[1])) {
+            spec = argv[1];
+        } else if (!parse_int(argv[1], msqid)) {
             std::cerr << "Error: Invalid msqid value.\n";
             print_usage();
             return 1;
@@ -52,7 +57,9 @@ int main(int argc, char* argv[]) {
         std::cout << "Enter message queue ID (msqid): ";
         std::string msqid_str;
         std::getline(std::cin, msqid_str);
-        if (!parse_int(msqid_str, msqid)) {
+        if (ShardedQueue::isSpec(msqid_str)) {
+            spec = msqid_str;
+        } else if (!parse_int(msqid_str, msqid)) {
             std::cerr << "Error: Invalid msqid value.\n";
             return 1;
         }
@@ -67,12 +74,21 @@ int main(int argc, char* argv[]) {
     }
 
     try {
-        MessageQueue::setMaxBytes(msqid, max_bytes);
+        std::vector<QueueInfo> infos;
+        if (!spec.empty()) {
+            ShardedQueue channel = ShardedQueue::attach(spec);
+            channel.setMaxBytes(max_bytes);
+            infos = channel.getInfo();
+        } else {
+            MessageQueue::setMaxBytes(msqid, max_bytes);
+            infos.push_back(MessageQueue::getInfo(msqid));
+        }
 
-        QueueInfo info = MessageQueue::getInfo(msqid);
         std::cout << "Queue max bytes changed successfully!\n";
-        std::cout << "  msqid     : " << info.msqid << "\n";
-        std::cout << "  max bytes : " << info.max_bytes << "\n";
+        for (const QueueInfo& info : infos) {
+            std::cout << "  msqid     : " << info.msqid << "\n";
+            std::cout << "  max bytes : " << info.max_bytes << "\n";
+        }
     } catch (const std::exception& e) {
         std::cerr << "Failed to change queue size: " << e.what() << "\n";
         return 1;
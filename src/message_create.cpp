@@ -1,4 +1,5 @@
 #include "message_queue.hpp"
+#include "sharded_queue.hpp"
 
 #include <iostream>
 #include <string>
@@ -53,16 +54,19 @@ std::string get_groupname(gid_t gid) {
 }
 
 void print_usage() {
-    std::cout << "Usage: message_create <key> <max_bytes> [permissions]\n"
+    std::cout << "Usage: message_create <key> <max_bytes> [permissions] [--shards <count>]\n"
               << "  <key>         : integer key for the queue\n"
-              << "  <max_bytes>   : maximum allowed bytes in queue\n"
-              << "  [permissions] : optional; octal permissions (default: 0600)\n";
+              << "  <max_bytes>   : maximum allowed bytes in queue (per shard)\n"
+              << "  [permissions] : optional; octal permissions (default: 0600)\n"
+              << "  [--shards <count>]: optional; create a sharded channel of <count> queues with keys\n"
+              << "                      <key> .. <key>+<count>-1, addressed as shard:<key>:<count>\n";
 }
 
 int main(int argc, char* argv[]) {
     key_t key = -1;
     size_t max_bytes = 0;
     unsigned short permissions = 0600;
+    size_t num_shards = 0;
 
     if (argc >= 3) {
         // -- key
@@ -77,9 +81,19 @@ int main(int argc, char* argv[]) {
             print_usage();
             return 1;
         }
-        // -- permissions (optional)
-        if (argc >= 4) {
-            if (!parse_permissions(argv[3], permissions)) {
+        // -- permissions and --shards (optional)
+        bool have_permissions = false;
+        for (int i = 3; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--shards" && i + 1 < argc) {
+                if (!parse_size_t(argv[++i], num_shards) || num_shards == 0 || num_shards > 1024) {
+                    std::cerr << "Error: Invalid shards value (1-1024).\n";
+                    print_usage();
+                    return 1;
+                }
+            } else if (!have_permissions && parse_permissions(arg, permissions)) {
+                have_permissions = true;
+            } else {
                 std::cerr << "Error: Invalid permissions value (should be octal, e.g. 0600).\n";
                 print_usage();
                 return 1;
@@ -113,6 +127,24 @@ int main(int argc, char* argv[]) {
         }
     }
 
+    if (num_shards != 0) {
+        try {
+            ShardedQueue channel = ShardedQueue::create(key, num_shards, max_bytes, permissions);
+            std::cout << "Sharded channel created successfully!\n";
+            std::cout << "  spec        : " << ShardedQueue::makeSpec(key, num_shards) << "\n";
+            std::cout << "  permissions : 0" << std::oct << permissions << std::dec << "\n";
+            std::cout << "  max bytes   : " << max_bytes << " per shard\n";
+            for (size_t i = 0; i < channel.getNumShards(); ++i) {
+                std::cout << "  shard " << i << "     : msqid " << channel.getMsqids()[i]
+                          << ", key " << key + static_cast<key_t>(i) << "\n";
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "Failed to create sharded channel: " << e.what() << "\n";
+            return 1;
+        }
+        return 0;
+    }
+
     try {
         MessageQueue mq = MessageQueue::create(key, max_bytes, permissions);
 
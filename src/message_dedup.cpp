@@ -0,0 +1,156 @@
+#include "message_dedup.hpp"
+#include "ipc_internal.hpp"
+
+#include <atomic>
+#include <random>
+#include <thread>
+#include <string>
+
+// --- Shared memory layout ---
+
+static const uint32_t DEDUP_MAGIC = 0x44445550;  // "DDUP"
+static const size_t SLOTS_PER_BUCKET = 4;
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared counters must be lock-free");
+
+struct DedupEntry {
+    uint64_t id;        // 0 = empty
+    uint64_t seen_ms;   // Monotonic time the id was first seen
+};
+
+struct DedupBucket {
+    std::atomic<uint32_t> lock;
+    uint32_t reserved;
+    DedupEntry entries[SLOTS_PER_BUCKET];
+};
+
+struct DedupHeader {
+    ShmSegmentHeader segment;    // segment.num_slots is the number of DedupBuckets
+    uint64_t window_ms;
+    std::atomic<uint64_t> checked;
+    std::atomic<uint64_t> duplicates;
+};
+
+static DedupHeader *header_of(void *addr) {
+    return static_cast<DedupHeader *>(addr);
+}
+
+static DedupBucket *buckets_of(void *addr) {
+    return reinterpret_cast<DedupBucket *>(static_cast<char *>(addr) + sizeof(DedupHeader));
+}
+
+// --- Static section ---
+DedupFilter DedupFilter::open(key_t key, size_t capacity, unsigned int window_ms, unsigned short permissions) {
+    if (capacity == 0) throw std::invalid_argument("Dedup capacity must be positive");
+
+    size_t num_buckets = (capacity + SLOTS_PER_BUCKET - 1) / SLOTS_PER_BUCKET;
+    size_t size = sizeof(DedupHeader) + num_buckets * sizeof(DedupBucket);
+
+    int shmid;
+    void *addr = createSegment(key, size, permissions, "dedup filter", shmid);
+    if (!addr) return attach(key);
+
+    // New segments are zero-filled, which is already a valid empty table
+    header_of(addr)->window_ms = window_ms;
+    publishSegment(addr, DEDUP_MAGIC, num_buckets);
+    return DedupFilter(shmid, addr, num_buckets);
+}
+
+DedupFilter DedupFilter::attach(key_t key) {
+    int shmid;
+    uint64_t num_buckets;
+    void *addr = attachSegment(key, DEDUP_MAGIC, sizeof(DedupHeader), sizeof(DedupBucket), "dedup filter", shmid,
+                               num_buckets);
+    return DedupFilter(shmid, addr, num_buckets);
+}
+
+uint64_t DedupFilter::generateMessageId() {
+    thread_local std::mt19937_64 gen(std::random_device{}());
+    uint64_t id;
+    do {
+        id = gen();
+    } while (id == 0);
+    return id;
+}
+
+// --- Non-static (object) section ---
+DedupFilter::DedupFilter(int shmid, void *addr, uint64_t num_buckets)
+    : shmid_(shmid), addr_(addr), num_buckets_(num_buckets)
+{}
+
+DedupFilter::~DedupFilter() {
+    detachSegment(addr_);
+}
+
+DedupFilter::DedupFilter(DedupFilter&& other) noexcept
+    : shmid_(other.shmid_), addr_(other.addr_), num_buckets_(other.num_buckets_)
+{
+    other.addr_ = nullptr;
+}
+
+DedupFilter& DedupFilter::operator=(DedupFilter&& other) noexcept {
+    if (this != &other) {
+        detachSegment(addr_);
+        shmid_ = other.shmid_;
+        addr_ = other.addr_;
+        num_buckets_ = other.num_buckets_;
+        other.addr_ = nullptr;
+    }
+    return *this;
+}
+
+bool DedupFilter::checkAndInsert(uint64_t id) {
+    if (id == 0) throw std::invalid_argument("Message id 0 is reserved");
+
+    DedupHeader *hdr = header_of(addr_);
+    DedupBucket &bucket = buckets_of(addr_)[mix64(id) % num_buckets_];
+    uint64_t now = static_cast<uint64_t>(monotonicMs());
+    uint64_t window = hdr->window_ms;
+
+    while (bucket.lock.exchange(1, std::memory_order_acquire) != 0) {
+        std::this_thread::yield();
+    }
+
+    bool duplicate = false;
+    DedupEntry *free_slot = nullptr;
+    DedupEntry *oldest = &bucket.entries[0];
+    for (DedupEntry &entry : bucket.entries) {
+        bool live = entry.id != 0 && (window == 0 || now - entry.seen_ms < window);
+        if (!live) {
+            if (!free_slot) free_slot = &entry;
+            continue;
+        }
+        if (entry.id == id) {
+            duplicate = true;
+            break;
+        }
+        if (entry.seen_ms < oldest->seen_ms) oldest = &entry;
+    }
+    if (!duplicate) {
+        // Prefer a free (empty or expired) slot, otherwise evict the oldest entry
+        DedupEntry *slot = free_slot ? free_slot : oldest;
+        slot->id = id;
+        slot->seen_ms = now;
+    }
+
+    bucket.lock.store(0, std::memory_order_release);
+
+    hdr->checked.fetch_add(1, std::memory_order_relaxed);
+    if (duplicate) hdr->duplicates.fetch_add(1, std::memory_order_relaxed);
+    return duplicate;
+}
+
+DedupStats DedupFilter::getStats() const {
+    const DedupHeader *hdr = header_of(addr_);
+    DedupStats stats;
+    stats.checked = hdr->checked.load(std::memory_order_relaxed);
+    stats.duplicates = hdr->duplicates.load(std::memory_order_relaxed);
+    stats.hit_rate = stats.checked ? static_cast<double>(stats.duplicates) / stats.checked : 0.0;
+    stats.capacity = num_buckets_ * SLOTS_PER_BUCKET;
+    stats.window_ms = static_cast<unsigned int>(hdr->window_ms);
+    return stats;
+}
+
+void DedupFilter::remove() {
+    removeSegment(shmid_, "dedup filter");
+}
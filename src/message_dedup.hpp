@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <stdexcept>
+#include <sys/types.h>
+
+// Snapshot of deduplication counters shared by all consumers of a filter
+struct DedupStats {
+    uint64_t checked;          // Message ids checked against the filter
+    uint64_t duplicates;       // Ids rejected as duplicates
+    double hit_rate;           // duplicates / checked (0 if nothing checked)
+    size_t capacity;           // Number of ids the filter can remember
+    unsigned int window_ms;    // How long an id is remembered (0 = until evicted)
+};
+
+// Bounded-memory, time-windowed set of recently seen 64-bit message ids, stored in a
+// System V shared memory segment so every consumer of a queue shares one view.
+//
+// The table is set-associative: each id hashes to a bucket of a few slots guarded by a
+// per-bucket spinlock. Entries older than the window count as free, and a full bucket
+// evicts its oldest entry. Full ids are stored, so there are no false positives; an id
+// evicted before its window ends may slip through as a (rare) false negative.
+class DedupFilter {
+public:
+    // Create the shared filter for key, or attach to it if it already exists
+    // (capacity and window_ms are then taken from the existing segment).
+    // Throws std::runtime_error on failure
+    static DedupFilter open(key_t key, size_t capacity, unsigned int window_ms, unsigned short permissions = 0600);
+
+    // Attach to an existing shared filter
+    // Throws std::runtime_error on failure
+    static DedupFilter attach(key_t key);
+
+    // Generate a random non-zero message id, suitable for sendMessageWithId
+    static uint64_t generateMessageId();
+
+    // Record id as seen. Returns true if it was already seen within the window (duplicate).
+    // Throws std::invalid_argument if id is 0 (reserved)
+    bool checkAndInsert(uint64_t id);
+
+    // Get shared counters and configuration
+    DedupStats getStats() const;
+
+    // Remove (delete) the shared memory segment. Attached processes keep their mapping
+    // until they detach.
+    // Throws std::runtime_error on failure
+    void remove();
+
+    // Get underlying shmid
+    int getShmid() const { return shmid_; }
+
+    // Destructor: detaches from the shared memory segment
+    ~DedupFilter();
+
+    // Deleted copy operations
+    DedupFilter(const DedupFilter&) = delete;
+    DedupFilter& operator=(const DedupFilter&) = delete;
+
+    // Allowed move operations
+    DedupFilter(DedupFilter&& other) noexcept;
+    DedupFilter& operator=(DedupFilter&& other) noexcept;
+
+private:
+    DedupFilter(int shmid, void *addr, uint64_t num_buckets);
+
+    int shmid_;
+    void *addr_;
+    uint64_t num_buckets_;   // Validated bucket count, never re-read from the shared header
+};
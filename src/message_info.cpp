@@ -1,7 +1,10 @@
 #include "message_queue.hpp"
+#include "sharded_queue.hpp"
 
 #include <iostream>
 #include <string>
+#include <iomanip>
+#include <vector>
 #include <pwd.h>
 #include <grp.h>
 
@@ -36,15 +39,103 @@ std::string get_groupname(gid_t gid) {
     return gr ? gr->gr_name : std::to_string(gid);
 }
 
+bool parse_key_t(const std::string& s, key_t& key) {
+    try {
+        size_t idx;
+        long k = std::stol(s, &idx, 0);
+        if (idx != s.size() || k < 0) return false;
+        key = static_cast<key_t>(k);
+        return true;
+    } catch (...) {
+        return false;
+    }
+}
+
 void print_usage() {
-    std::cout << "Usage: message_info <msqid>\n"
-              << "  <msqid>: message queue ID to show info\n";
+    std::cout << "Usage: message_info <msqid> | shard:<base_key>:<count> | --key <key> | --all|-a\n"
+              << "  <msqid>     : message queue ID to show info\n"
+              << "  shard:<base_key>:<count> : show per-shard info and totals for a sharded channel\n"
+              << "  --key <key> : show info for the queue created with <key>\n"
+              << "  --all|-a    : list all message queues in the system\n";
+}
+
+void print_table(const std::vector<QueueInfo>& queues) {
+    std::cout << std::left << std::setw(12) << "key" << std::setw(10) << "msqid" << std::setw(12) << "owner"
+              << std::setw(8) << "perms" << std::setw(12) << "used-bytes" << std::setw(12) << "max-bytes"
+              << "messages\n";
+    for (const QueueInfo& info : queues) {
+        std::cout << std::setw(12) << info.key << std::setw(10) << info.msqid
+                  << std::setw(12) << get_username(info.owner_uid)
+                  << "0" << std::setw(7) << std::oct << info.permissions << std::dec
+                  << std::setw(12) << info.used_bytes << std::setw(12) << info.max_bytes
+                  << info.num_messages << "\n";
+    }
+}
+
+int list_all() {
+    try {
+        std::vector<QueueInfo> queues = MessageQueue::listAll();
+        print_table(queues);
+        std::cout << queues.size() << " queue(s)\n";
+    } catch (const std::exception& e) {
+        std::cerr << "Failed to list queues: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
+
+int show_channel(const std::string& spec) {
+    try {
+        std::vector<QueueInfo> shards = ShardedQueue::attach(spec).getInfo();
+        size_t used_bytes = 0, max_bytes = 0;
+        unsigned long num_messages = 0;
+        for (const QueueInfo& info : shards) {
+            used_bytes += info.used_bytes;
+            max_bytes += info.max_bytes;
+            num_messages += info.num_messages;
+        }
+
+        std::cout << "Sharded channel " << spec << ":\n";
+        print_table(shards);
+        std::cout << shards.size() << " shard(s), " << used_bytes << " of " << max_bytes << " bytes used, "
+                  << num_messages << " message(s)\n";
+    } catch (const std::exception& e) {
+        std::cerr << "Sharded channel info unavailable: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
 }
 
 int main(int argc, char* argv[]) {
     int msqid = -1;
 
-    if (argc >= 2) {
+    if (argc >= 2 && ShardedQueue::isSpec(argv[1])) {
+        return show_channel(argv[1]);
+    }
+
+    if (argc >= 2 && (std::string(argv[1]) == "--all" || std::string(argv[1]) == "-a")) {
+        return list_all();
+    }
+
+    if (argc >= 2 && std::string(argv[1]) == "--key") {
+        key_t key = -1;
+        if (argc < 3 || !parse_key_t(argv[2], key)) {
+            std::cerr << "Error: Invalid key value.\n";
+            print_usage();
+            return 1;
+        }
+        try {
+            std::optional<QueueInfo> found = MessageQueue::findByKey(key);
+            if (!found) {
+                std::cerr << "No message queue with key " << key << ".\n";
+                return 1;
+            }
+            msqid = found->msqid;
+        } catch (const std::exception& e) {
+            std::cerr << "Failed to look up key: " << e.what() << "\n";
+            return 1;
+        }
+    } else if (argc >= 2) {
         if (!parse_int(argv[1], msqid)) {
             std::cerr << "Error: Invalid msqid value.\n";
             print_usage();
@@ -72,6 +163,8 @@ int main(int argc, char* argv[]) {
         std::cout << "  max bytes     : " << info.max_bytes << "\n";
         std::cout << "  used bytes    : " << info.used_bytes << "\n";
         std::cout << "  num messages  : " << info.num_messages << "\n";
+        ExpiryStats expiry = MessageQueue::getExpiryStats(msqid);
+        std::cout << "  expired       : " << expiry.expired_messages << " messages (" << expiry.expired_bytes << " bytes)\n";
         std::cout << "  last send     : " << format_time(info.last_send_time) << "\n";
         std::cout << "  last receive  : " << format_time(info.last_recv_time) << "\n";
         std::cout << "  last change   : " << format_time(info.last_change_time) << "\n";
@@ -0,0 +1,650 @@
+#include "message_queue.hpp"
+#include "message_quota.hpp"
+#include "sharded_queue.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <climits>
+#include <memory>
+
+// Load generator for capacity planning.
+// Producer threads send to an existing queue following a synthetic arrival process or a
+// recorded trace; consumer threads receive and measure end-to-end latency from the scheduled
+// send time carried in the first 8 bytes of every payload. Stamping the schedule rather than
+// the moment msgsnd succeeds keeps time spent waiting behind a full queue in the latency
+// (no coordinated omission). A sampler thread records queue
+// fill from getInfo while the run is in progress.
+// A sharded channel spec may be given instead of a msqid: producers then route by CPU and
+// consumers start at their own home shard and steal from the others.
+// Consumers poll without blocking, so that shutdown needs no in-band stop messages (which a
+// full queue could refuse): once the producers are done, each consumer exits as soon as
+// nothing of its type is left, or when the drain timeout expires.
+
+using Clock = std::chrono::steady_clock;
+
+static const size_t STAMP_SIZE = sizeof(int64_t);
+static const unsigned int CONSUMER_POLL_MAX_US = 100;  // Idle consumers back off up to this
+static const int DRAIN_TIMEOUT_S = 10;                 // Time consumers get to drain the backlog
+
+enum class Arrival { Constant, Poisson, Bursty };
+enum class OnFull { Retry, Drop };
+enum class Format { Text, Csv, Json };
+
+struct Range {
+    long min;
+    long max;
+};
+
+struct TraceRecord {
+    uint64_t t_us;  // Offset from the start of the replay
+    long type;
+    size_t size;
+};
+
+struct Config {
+    int msqid = -1;
+    unsigned int producers = 1;
+    unsigned int consumers = 1;
+    double rate = 1000.0;              // Total messages/second, 0 = as fast as possible
+    Arrival arrival = Arrival::Constant;
+    unsigned int burst = 10;
+    double duration_s = 10.0;
+    uint64_t count = 0;                // 0 = limited by duration only
+    Range size = {64, 64};
+    Range type = {1, 1};
+    long recv_type = 0;
+    OnFull on_full = OnFull::Retry;
+    uint64_t seed = 1;
+    std::string replay_path;
+    double speed = 1.0;
+    unsigned int sample_ms = 100;
+    Format format = Format::Text;
+    key_t quota_key = 0;               // 0 = no per-type quota
+};
+
+struct ProducerStats {
+    uint64_t sent = 0;
+    uint64_t eagain = 0;
+    uint64_t over_quota = 0;
+    uint64_t dropped = 0;
+    uint64_t errors = 0;
+};
+
+struct ConsumerStats {
+    uint64_t received = 0;
+    uint64_t errors = 0;
+    std::vector<double> latencies_us;
+};
+
+struct FillSample {
+    double t_ms;
+    size_t used_bytes;
+    unsigned int num_messages;
+};
+
+static std::atomic<bool> g_stop{false};
+static std::atomic<bool> g_producers_done{false};
+static std::atomic<int64_t> g_drain_deadline_ns{INT64_MAX};
+static std::unique_ptr<TypeQuota> g_quota;
+static std::unique_ptr<ShardedQueue> g_shards;
+static std::mutex g_error_mutex;
+static std::string g_last_error;
+
+static void record_error(const std::string& what) {
+    std::lock_guard<std::mutex> lock(g_error_mutex);
+    g_last_error = what;
+}
+
+bool parse_int(const std::string& s, int& value) {
+    try {
+        size_t idx;
+        long v = std::stol(s, &idx, 0);
+        if (idx != s.size() || v < 0) return false;
+        value = static_cast<int>(v);
+        return true;
+    } catch (...) {
+        return false;
+    }
+}
+
+bool parse_uint64(const std::string& s, uint64_t& value) {
+    try {
+        size_t idx;
+        value = std::stoull(s, &idx, 0);
+        return idx == s.size() && s[0] != '-';
+    } catch (...) {
+        return false;
+    }
+}
+
+bool parse_double(const std::string& s, double& value) {
+    try {
+        size_t idx;
+        value = std::stod(s, &idx);
+        return idx == s.size() && value >= 0;
+    } catch (...) {
+        return false;
+    }
+}
+
+// Parse "N" or "MIN-MAX" (both positive)
+bool parse_range(const std::string& s, Range& range) {
+    try {
+        size_t idx;
+        size_t dash = s.find('-', 1);
+        range.min = std::stol(s.substr(0, dash), &idx, 0);
+        range.max = range.min;
+        if (dash != std::string::npos) {
+            std::string tail = s.substr(dash + 1);
+            range.max = std::stol(tail, &idx, 0);
+            if (idx != tail.size()) return false;
+        } else if (idx != s.size()) {
+            return false;
+        }
+        return range.min > 0 && range.max >= range.min;
+    } catch (...) {
+        return false;
+    }
+}
+
+// Trace format: one "timestamp_us,type,size" record per line (commas or whitespace), '#' comments
+bool load_trace(const std::string& path, std::vector<TraceRecord>& records, std::string& error) {
+    std::ifstream in(path);
+    if (!in) {
+        error = "cannot open trace file '" + path + "'";
+        return false;
+    }
+    std::string line;
+    size_t lineno = 0;
+    while (std::getline(in, line)) {
+        ++lineno;
+        line = line.substr(0, line.find('#'));
+        std::replace(line.begin(), line.end(), ',', ' ');
+        std::istringstream iss(line);
+        TraceRecord rec;
+        if (!(iss >> rec.t_us)) continue;  // blank or comment line
+        if (!(iss >> rec.type >> rec.size) || rec.type <= 0 || rec.size == 0) {
+            error = "invalid trace record at line " + std::to_string(lineno);
+            return false;
+        }
+        records.push_back(rec);
+    }
+    std::stable_sort(records.begin(), records.end(),
+                     [](const TraceRecord& a, const TraceRecord& b) { return a.t_us < b.t_us; });
+    return true;
+}
+
+void print_usage() {
+    std::cout << "Usage: message_loadgen <msqid|shard:<base_key>:<count>> [options]\n"
+              << "  <msqid>                    : existing message queue ID to drive\n"
+              << "  shard:<base_key>:<count>   : or an existing sharded channel (see message_create --shards)\n"
+              << "  --producers <n>            : producer threads (default: 1)\n"
+              << "  --consumers <n>            : consumer threads (default: 1, 0 = fill only)\n"
+              << "  --rate <msgs/s>            : total send rate (default: 1000, 0 = unthrottled)\n"
+              << "  --arrival <process>        : constant | poisson | bursty (default: constant)\n"
+              << "  --burst <n>                : messages per burst for bursty arrivals (default: 10)\n"
+              << "  --duration <s>             : run time in seconds (default: 10)\n"
+              << "  --count <n>                : stop after sending n messages in total\n"
+              << "  --size <n|min-max>         : payload size in bytes, uniform in range (default: 64)\n"
+              << "  --type <n|min-max>         : message type, uniform in range (default: 1)\n"
+              << "  --recv-type <n>            : type consumers receive (default: 0 = any)\n"
+              << "  --on-full <retry|drop>     : what to do when the queue is full (default: retry)\n"
+              << "  --seed <n>                 : random seed, runs are reproducible (default: 1)\n"
+              << "  --replay <file>            : replay a trace of 'timestamp_us,type,size' records\n"
+              << "  --speed <x>                : replay speed multiplier (default: 1)\n"
+              << "  --sample-ms <ms>           : queue fill sampling interval (default: 100)\n"
+              << "  --format <text|csv|json>   : report format (default: text)\n"
+              << "  --quota <key>              : send and receive through the per-type quota table <key>\n"
+              << "  Payloads shorter than " << STAMP_SIZE << " bytes are padded to carry the scheduled send time.\n";
+}
+
+// Build a payload of the given size whose first bytes hold the scheduled send time
+static std::string make_payload(size_t size, int64_t stamp) {
+    std::string payload(std::max(size, STAMP_SIZE), 'x');
+    std::memcpy(&payload[0], &stamp, STAMP_SIZE);
+    return payload;
+}
+
+static int64_t stamp_of(Clock::time_point t) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch()).count();
+}
+
+static int64_t now_ns() {
+    return stamp_of(Clock::now());
+}
+
+// Send one message stamped with its scheduled send time, honoring the queue-full policy.
+// Retries keep the original stamp. Returns false on a fatal error.
+static bool send_one(const Config& cfg, long type, size_t size, int64_t stamp, ProducerStats& st) {
+    try {
+        std::string payload = make_payload(size, stamp);
+        for (;;) {
+            SendStatus status;
+            if (g_shards) {
+                status = g_shards->trySendMessage(type, payload) ? SendStatus::Sent : SendStatus::QueueFull;
+            } else if (g_quota) {
+                status = MessageQueue::trySendMessageQuota(cfg.msqid, type, payload, *g_quota);
+            } else {
+                status = MessageQueue::trySendMessage(cfg.msqid, type, payload) ? SendStatus::Sent : SendStatus::QueueFull;
+            }
+            if (status == SendStatus::Sent) {
+                ++st.sent;
+                return true;
+            }
+            if (status == SendStatus::OverQuota) ++st.over_quota;
+            else ++st.eagain;
+            if (cfg.on_full == OnFull::Drop || g_stop.load(std::memory_order_relaxed)) {
+                ++st.dropped;
+                return true;
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    } catch (const std::exception& e) {
+        ++st.errors;
+        record_error(e.what());
+        return false;
+    }
+}
+
+static void run_producer(const Config& cfg, unsigned int idx, Clock::time_point start, ProducerStats& st) {
+    std::mt19937_64 rng(cfg.seed + idx);
+    std::uniform_int_distribution<long> size_dist(cfg.size.min, cfg.size.max);
+    std::uniform_int_distribution<long> type_dist(cfg.type.min, cfg.type.max);
+
+    double rate = cfg.rate / cfg.producers;
+    std::exponential_distribution<double> exp_dist(rate > 0 ? rate : 1.0);
+
+    uint64_t quota = UINT64_MAX;
+    if (cfg.count > 0) {
+        quota = cfg.count / cfg.producers + (idx < cfg.count % cfg.producers ? 1 : 0);
+    }
+
+    // Open-loop schedule: if we fall behind, send immediately to catch up
+    double next_s = 0.0;
+    for (uint64_t n = 0; n < quota && !g_stop.load(std::memory_order_relaxed); ++n) {
+        // Without a rate the producer runs closed-loop and each message is due right away
+        int64_t stamp;
+        if (rate > 0) {
+            Clock::time_point due = start + std::chrono::duration_cast<Clock::duration>(
+                std::chrono::duration<double>(next_s));
+            std::this_thread::sleep_until(due);
+            stamp = stamp_of(due);
+            switch (cfg.arrival) {
+                case Arrival::Constant: next_s += 1.0 / rate; break;
+                case Arrival::Poisson:  next_s += exp_dist(rng); break;
+                case Arrival::Bursty:
+                    if ((n + 1) % cfg.burst == 0) next_s += cfg.burst / rate;
+                    break;
+            }
+        } else {
+            stamp = now_ns();
+        }
+        if (!send_one(cfg, type_dist(rng), static_cast<size_t>(size_dist(rng)), stamp, st)) return;
+    }
+}
+
+static void run_replay_producer(const Config& cfg, unsigned int idx, Clock::time_point start,
+                                const std::vector<TraceRecord>& records, ProducerStats& st) {
+    for (size_t i = idx; i < records.size() && !g_stop.load(std::memory_order_relaxed); i += cfg.producers) {
+        const TraceRecord& rec = records[i];
+        Clock::time_point due = start + std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double, std::micro>(rec.t_us / cfg.speed));
+        std::this_thread::sleep_until(due);
+        if (!send_one(cfg, rec.type, rec.size, stamp_of(due), st)) return;
+    }
+}
+
+// Receive one message without blocking; returns false if none of the type is queued
+static bool try_receive(const Config& cfg, unsigned int idx, std::string& msg) {
+    if (g_shards) return g_shards->tryReceiveMessage(cfg.recv_type, idx % g_shards->getNumShards(), msg);
+    if (!g_quota) return MessageQueue::tryReceiveMessage(cfg.msqid, cfg.recv_type, msg);
+    try {
+        msg = MessageQueue::receiveMessageQuota(cfg.msqid, cfg.recv_type, *g_quota, true);
+        return true;
+    } catch (const std::runtime_error& e) {
+        if (std::string(e.what()).find("No message") != std::string::npos) return false;
+        throw;
+    }
+}
+
+static void run_consumer(const Config& cfg, unsigned int idx, ConsumerStats& st) {
+    unsigned int backoff_us = 0;
+    for (;;) {
+        try {
+            // Read the flag before polling: once the producers are done, an empty poll means
+            // nothing of our type is left and nothing more will arrive
+            bool done = g_producers_done.load(std::memory_order_acquire);
+            if (done && now_ns() >= g_drain_deadline_ns.load()) {
+                ++st.errors;
+                record_error("consumers stopped after the " + std::to_string(DRAIN_TIMEOUT_S)
+                             + " s drain timeout with messages still queued");
+                return;
+            }
+            std::string msg;
+            if (!try_receive(cfg, idx, msg)) {
+                if (done) return;
+                // Idle: yield first, then sleep from 10 us doubling up to CONSUMER_POLL_MAX_US
+                if (backoff_us == 0) {
+                    std::this_thread::yield();
+                    backoff_us = 10;
+                } else {
+                    std::this_thread::sleep_for(std::chrono::microseconds(backoff_us));
+                    backoff_us = std::min(backoff_us * 2, CONSUMER_POLL_MAX_US);
+                }
+                continue;
+            }
+            backoff_us = 0;
+            ++st.received;
+            // Messages too short for a stamp were not sent by the load generator
+            if (msg.size() < STAMP_SIZE) continue;
+            int64_t stamp;
+            std::memcpy(&stamp, msg.data(), STAMP_SIZE);
+            st.latencies_us.push_back((now_ns() - stamp) / 1000.0);
+        } catch (const std::exception& e) {
+            ++st.errors;
+            record_error(e.what());
+            return;
+        }
+    }
+}
+
+// Queue info, summed over all shards for a sharded channel
+static QueueInfo channel_info(int msqid) {
+    if (!g_shards) return MessageQueue::getInfo(msqid);
+    std::vector<QueueInfo> shards = g_shards->getInfo();
+    QueueInfo total = shards[0];
+    for (size_t i = 1; i < shards.size(); ++i) {
+        total.max_bytes += shards[i].max_bytes;
+        total.used_bytes += shards[i].used_bytes;
+        total.num_messages += shards[i].num_messages;
+    }
+    return total;
+}
+
+static double percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) return 0.0;
+    return sorted[static_cast<size_t>(p * (sorted.size() - 1))];
+}
+
+int main(int argc, char* argv[]) {
+    Config cfg;
+
+    if (argc >= 2 && ShardedQueue::isSpec(argv[1])) {
+        try {
+            g_shards.reset(new ShardedQueue(ShardedQueue::attach(std::string(argv[1]))));
+            cfg.msqid = g_shards->getMsqids()[0];
+        } catch (const std::exception& e) {
+            std::cerr << "Failed to attach to sharded channel: " << e.what() << "\n";
+            return 1;
+        }
+    } else if (argc < 2 || !parse_int(argv[1], cfg.msqid)) {
+        if (argc >= 2 && std::string(argv[1]) != "--help" && std::string(argv[1]) != "-h")
+            std::cerr << "Error: Invalid msqid value.\n";
+        print_usage();
+        return argc >= 2 ? 1 : 0;
+    }
+
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            std::cerr << "Error: Missing value for " << arg << ".\n";
+            print_usage();
+            return 1;
+        }
+        std::string val = argv[++i];
+        uint64_t n = 0;
+        bool ok = true;
+        if (arg == "--producers") {
+            ok = parse_uint64(val, n) && n > 0 && n <= 1024;
+            cfg.producers = static_cast<unsigned int>(n);
+        } else if (arg == "--consumers") {
+            ok = parse_uint64(val, n) && n <= 1024;
+            cfg.consumers = static_cast<unsigned int>(n);
+        } else if (arg == "--rate") {
+            ok = parse_double(val, cfg.rate);
+        } else if (arg == "--arrival") {
+            if (val == "constant") cfg.arrival = Arrival::Constant;
+            else if (val == "poisson") cfg.arrival = Arrival::Poisson;
+            else if (val == "bursty") cfg.arrival = Arrival::Bursty;
+            else ok = false;
+        } else if (arg == "--burst") {
+            ok = parse_uint64(val, n) && n > 0 && n <= 1000000;
+            cfg.burst = static_cast<unsigned int>(n);
+        } else if (arg == "--duration") {
+            ok = parse_double(val, cfg.duration_s) && cfg.duration_s > 0;
+        } else if (arg == "--count") {
+            ok = parse_uint64(val, cfg.count);
+        } else if (arg == "--size") {
+            ok = parse_range(val, cfg.size);
+        } else if (arg == "--type") {
+            ok = parse_range(val, cfg.type);
+        } else if (arg == "--recv-type") {
+            ok = parse_uint64(val, n) && n <= static_cast<uint64_t>(LONG_MAX);
+            cfg.recv_type = static_cast<long>(n);
+        } else if (arg == "--on-full") {
+            if (val == "retry") cfg.on_full = OnFull::Retry;
+            else if (val == "drop") cfg.on_full = OnFull::Drop;
+            else ok = false;
+        } else if (arg == "--seed") {
+            ok = parse_uint64(val, cfg.seed);
+        } else if (arg == "--replay") {
+            cfg.replay_path = val;
+        } else if (arg == "--speed") {
+            ok = parse_double(val, cfg.speed) && cfg.speed > 0;
+        } else if (arg == "--sample-ms") {
+            ok = parse_uint64(val, n) && n > 0 && n <= 60000;
+            cfg.sample_ms = static_cast<unsigned int>(n);
+        } else if (arg == "--quota") {
+            ok = parse_uint64(val, n) && n > 0 && n <= static_cast<uint64_t>(INT_MAX);
+            cfg.quota_key = static_cast<key_t>(n);
+        } else if (arg == "--format") {
+            if (val == "text") cfg.format = Format::Text;
+            else if (val == "csv") cfg.format = Format::Csv;
+            else if (val == "json") cfg.format = Format::Json;
+            else ok = false;
+        } else {
+            std::cerr << "Error: Unknown option '" << arg << "'.\n";
+            print_usage();
+            return 1;
+        }
+        if (!ok) {
+            std::cerr << "Error: Invalid value for " << arg << ".\n";
+            print_usage();
+            return 1;
+        }
+    }
+
+    if (g_shards && cfg.quota_key != 0) {
+        std::cerr << "Error: --quota cannot be used with a sharded channel.\n";
+        return 1;
+    }
+
+    std::vector<TraceRecord> trace;
+    if (!cfg.replay_path.empty()) {
+        std::string error;
+        if (!load_trace(cfg.replay_path, trace, error)) {
+            std::cerr << "Error: " << error << ".\n";
+            return 1;
+        }
+    }
+
+    QueueInfo initial;
+    try {
+        initial = channel_info(cfg.msqid);
+        if (cfg.quota_key != 0) g_quota.reset(new TypeQuota(TypeQuota::open(cfg.quota_key)));
+    } catch (const std::exception& e) {
+        std::cerr << "Failed to attach to queue: " << e.what() << "\n";
+        return 1;
+    }
+
+    std::vector<ProducerStats> pstats(cfg.producers);
+    std::vector<ConsumerStats> cstats(cfg.consumers);
+    std::vector<FillSample> fill;
+    std::atomic<bool> sampling{true};
+
+    Clock::time_point start = Clock::now();
+
+    std::thread sampler([&] {
+        do {
+            try {
+                QueueInfo info = channel_info(cfg.msqid);
+                double t_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+                fill.push_back({t_ms, info.used_bytes, info.num_messages});
+            } catch (const std::exception& e) {
+                record_error(e.what());
+                return;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(cfg.sample_ms));
+        } while (sampling.load());
+    });
+
+    std::vector<std::thread> consumers;
+    for (unsigned int c = 0; c < cfg.consumers; ++c) {
+        consumers.emplace_back(run_consumer, std::cref(cfg), c, std::ref(cstats[c]));
+    }
+
+    std::vector<std::thread> producers;
+    for (unsigned int p = 0; p < cfg.producers; ++p) {
+        if (cfg.replay_path.empty())
+            producers.emplace_back(run_producer, std::cref(cfg), p, start, std::ref(pstats[p]));
+        else
+            producers.emplace_back(run_replay_producer, std::cref(cfg), p, start, std::cref(trace), std::ref(pstats[p]));
+    }
+
+    // Duration limit (replays run to the end of the trace)
+    std::thread timer([&] {
+        if (!cfg.replay_path.empty()) return;
+        auto deadline = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(cfg.duration_s));
+        while (!g_stop.load() && Clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        g_stop.store(true);
+    });
+
+    for (std::thread& t : producers) t.join();
+    double send_elapsed_s = std::chrono::duration<double>(Clock::now() - start).count();
+    g_stop.store(true);
+    timer.join();
+
+    // Consumers drain the backlog, then exit on their own
+    g_drain_deadline_ns.store(now_ns() + DRAIN_TIMEOUT_S * INT64_C(1000000000));
+    g_producers_done.store(true, std::memory_order_release);
+    for (std::thread& t : consumers) t.join();
+    double total_elapsed_s = std::chrono::duration<double>(Clock::now() - start).count();
+    sampling.store(false);
+    sampler.join();
+
+    // --- Aggregate ---
+    ProducerStats ptotal;
+    for (const ProducerStats& st : pstats) {
+        ptotal.sent += st.sent;
+        ptotal.eagain += st.eagain;
+        ptotal.over_quota += st.over_quota;
+        ptotal.dropped += st.dropped;
+        ptotal.errors += st.errors;
+    }
+    uint64_t received = 0, recv_errors = 0;
+    std::vector<double> lat;
+    for (ConsumerStats& st : cstats) {
+        received += st.received;
+        recv_errors += st.errors;
+        lat.insert(lat.end(), st.latencies_us.begin(), st.latencies_us.end());
+    }
+    std::sort(lat.begin(), lat.end());
+
+    size_t peak_bytes = 0;
+    unsigned int peak_messages = 0;
+    for (const FillSample& s : fill) {
+        peak_bytes = std::max(peak_bytes, s.used_bytes);
+        peak_messages = std::max(peak_messages, s.num_messages);
+    }
+
+    double send_rate = ptotal.sent / send_elapsed_s;
+    double recv_rate = received / total_elapsed_s;
+    struct { const char* name; double value; } pct[] = {
+        {"p50", percentile(lat, 0.50)}, {"p90", percentile(lat, 0.90)}, {"p99", percentile(lat, 0.99)},
+        {"p999", percentile(lat, 0.999)}, {"max", lat.empty() ? 0.0 : lat.back()},
+    };
+
+    // --- Report ---
+    size_t num_shards = g_shards ? g_shards->getNumShards() : 1;
+    std::cout << std::fixed << std::setprecision(2);
+    if (cfg.format == Format::Json) {
+        std::cout << "{\n"
+                  << "  \"msqid\": " << cfg.msqid << ",\n"
+                  << "  \"shards\": " << num_shards << ",\n"
+                  << "  \"max_bytes\": " << initial.max_bytes << ",\n"
+                  << "  \"producers\": " << cfg.producers << ",\n"
+                  << "  \"consumers\": " << cfg.consumers << ",\n"
+                  << "  \"elapsed_s\": " << total_elapsed_s << ",\n"
+                  << "  \"sent\": " << ptotal.sent << ",\n"
+                  << "  \"received\": " << received << ",\n"
+                  << "  \"eagain\": " << ptotal.eagain << ",\n"
+                  << "  \"over_quota\": " << ptotal.over_quota << ",\n"
+                  << "  \"dropped\": " << ptotal.dropped << ",\n"
+                  << "  \"errors\": " << ptotal.errors + recv_errors << ",\n"
+                  << "  \"send_rate\": " << send_rate << ",\n"
+                  << "  \"recv_rate\": " << recv_rate << ",\n"
+                  << "  \"peak_used_bytes\": " << peak_bytes << ",\n"
+                  << "  \"peak_messages\": " << peak_messages << ",\n"
+                  << "  \"latency_us\": {";
+        for (size_t i = 0; i < sizeof(pct) / sizeof(pct[0]); ++i) {
+            std::cout << (i ? ", " : "") << "\"" << pct[i].name << "\": " << pct[i].value;
+        }
+        std::cout << "},\n  \"fill\": [";
+        for (size_t i = 0; i < fill.size(); ++i) {
+            std::cout << (i ? "," : "") << "\n    {\"t_ms\": " << fill[i].t_ms << ", \"used_bytes\": "
+                      << fill[i].used_bytes << ", \"messages\": " << fill[i].num_messages << "}";
+        }
+        std::cout << "\n  ]\n}\n";
+    } else if (cfg.format == Format::Csv) {
+        std::cout << "# summary\n"
+                  << "msqid,shards,max_bytes,producers,consumers,elapsed_s,sent,received,eagain,over_quota,dropped,errors,"
+                  << "send_rate,recv_rate,peak_used_bytes,peak_messages";
+        for (const auto& p : pct) std::cout << ",latency_" << p.name << "_us";
+        std::cout << "\n" << cfg.msqid << "," << num_shards << "," << initial.max_bytes << "," << cfg.producers << "," << cfg.consumers
+                  << "," << total_elapsed_s << "," << ptotal.sent << "," << received << "," << ptotal.eagain
+                  << "," << ptotal.over_quota << "," << ptotal.dropped << "," << ptotal.errors + recv_errors << "," << send_rate << ","
+                  << recv_rate << "," << peak_bytes << "," << peak_messages;
+        for (const auto& p : pct) std::cout << "," << p.value;
+        std::cout << "\n# fill\nt_ms,used_bytes,messages\n";
+        for (const FillSample& s : fill) {
+            std::cout << s.t_ms << "," << s.used_bytes << "," << s.num_messages << "\n";
+        }
+    } else {
+        std::cout << "Load generation finished!\n";
+        if (g_shards)
+            std::cout << "  channel        : " << argv[1] << " (" << num_shards << " shards, max bytes " << initial.max_bytes << ")\n";
+        else
+            std::cout << "  msqid          : " << cfg.msqid << " (max bytes " << initial.max_bytes << ")\n";
+        std::cout << "  threads        : " << cfg.producers << " producer(s), " << cfg.consumers << " consumer(s)\n";
+        std::cout << "  elapsed        : " << total_elapsed_s << " s\n";
+        std::cout << "  sent           : " << ptotal.sent << " (" << send_rate << " msg/s)\n";
+        std::cout << "  received       : " << received << " (" << recv_rate << " msg/s)\n";
+        std::cout << "  EAGAIN         : " << ptotal.eagain << "\n";
+        std::cout << "  over quota     : " << ptotal.over_quota << "\n";
+        std::cout << "  dropped        : " << ptotal.dropped << "\n";
+        std::cout << "  errors         : " << ptotal.errors + recv_errors << "\n";
+        std::cout << "  peak fill      : " << peak_bytes << " bytes, " << peak_messages << " messages\n";
+        std::cout << "  latency (us)   :";
+        for (const auto& p : pct) std::cout << " " << p.name << "=" << p.value;
+        std::cout << "\n";
+    }
+
+    if (!g_last_error.empty()) {
+        std::cerr << "Last error: " << g_last_error << "\n";
+    }
+    return (ptotal.errors + recv_errors) ? 1 : 0;
+}
@@ -1,33 +1,206 @@
 #include "message_queue.hpp"
+#include "message_dedup.hpp"
+#include "message_quota.hpp"
+#include "ipc_internal.hpp"
 
 #include <sys/ipc.h>
 #include <sys/msg.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/shm.h>
+#include <unistd.h>
 #include <cstring>
 #include <cerrno>
 #include <stdexcept>
 #include <algorithm>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <unordered_set>
+
+// Framed messages (opt-in, see message_queue.hpp) start with a one-byte frame header whose flag
+// bits say which optional fields follow, so message ids and deadlines are never mistaken for payload:
+//   [flags] [message id, uint64 if FRAME_ID] [deadline in monotonic ms, int64 if FRAME_TTL] [payload]
+// Plain messages carry the payload only, exactly as sent.
+static const uint8_t FRAME_ID = 0x01;
+static const uint8_t FRAME_TTL = 0x02;
+static const size_t FRAME_MAX_HEADER = 1 + sizeof(uint64_t) + sizeof(int64_t);
+static const size_t MAX_PAYLOAD = 4096;
 
 // Internal message buffer struct (for System V)
 struct MsgBuffer {
     long mtype;
-    char mtext[4096];
+    char mtext[FRAME_MAX_HEADER + MAX_PAYLOAD];
+};
+
+// Optional frame fields (0 = absent)
+struct Frame {
+    uint64_t message_id = 0;
+    int64_t deadline_ms = 0;
+};
+
+// Expired-message counters of a queue live in a small shared memory segment of its own, so that
+// monitoring processes see what every consumer and reaper discarded. The segment is created on
+// first use by a process running as the queue's owner or creator, and removed together with the
+// queue by remove(). Receiving is what records into it, so everyone who may read the queue may
+// also write the counters. A segment under the key that the queue's owner or creator did not
+// create is ignored.
+static const uint32_t EXPIRY_KEY_BASE = 0x80000000;  // Segment key: EXPIRY_KEY_BASE | msqid
+static const uint32_t EXPIRY_MAGIC = 0x45585052;     // "EXPR"
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared counters must be lock-free");
+
+struct ExpiryHeader {
+    ShmSegmentHeader segment;    // No slots
+    int64_t msqid;               // Queue the counters belong to
+    std::atomic<uint64_t> expired_messages;
+    std::atomic<uint64_t> expired_bytes;
 };
 
+// msqids are non-negative ints, so every queue gets a distinct key that is never IPC_PRIVATE
+static key_t expiry_key(int msqid) {
+    return static_cast<key_t>(EXPIRY_KEY_BASE | static_cast<uint32_t>(msqid));
+}
+
+// Attach to the expiry counters of msqid and set shmid. If create is set, counters that do not
+// exist yet are created when this process runs as the queue's owner or creator. Returns nullptr
+// if the counters are unavailable: they are best-effort. Detach with detachSegment.
+static ExpiryHeader *expiry_counters(int msqid, bool create, int &shmid) {
+    struct msqid_ds queue;
+    if (msgctl(msqid, IPC_STAT, &queue) == -1) return nullptr;
+    key_t key = expiry_key(msqid);
+
+    void *addr;
+    uint64_t num_slots;
+    try {
+        addr = attachSegment(key, EXPIRY_MAGIC, sizeof(ExpiryHeader), 0, "expiry counters", shmid, num_slots);
+    } catch (const std::exception&) {
+        uid_t euid = geteuid();
+        if (!create || (euid != queue.msg_perm.uid && euid != queue.msg_perm.cuid)) return nullptr;
+        unsigned short readers = queue.msg_perm.mode & 0444;
+        try {
+            addr = createSegment(key, sizeof(ExpiryHeader), 0600 | readers | (readers >> 1), "expiry counters",
+                                 shmid);
+        } catch (const std::exception&) {
+            return nullptr;
+        }
+        if (!addr) return expiry_counters(msqid, false, shmid);  // Another process created them first
+        ExpiryHeader *hdr = static_cast<ExpiryHeader *>(addr);
+        hdr->msqid = msqid;
+        publishSegment(addr, EXPIRY_MAGIC, 0);
+        return hdr;
+    }
+
+    ExpiryHeader *hdr = static_cast<ExpiryHeader *>(addr);
+    struct shmid_ds segment;
+    bool trusted = shmctl(shmid, IPC_STAT, &segment) == 0
+                   && (segment.shm_perm.cuid == queue.msg_perm.uid || segment.shm_perm.cuid == queue.msg_perm.cuid)
+                   && hdr->msqid == msqid;
+    if (!trusted) {
+        detachSegment(addr);
+        return nullptr;
+    }
+    return hdr;
+}
+
+// Write the frame header for frame into bufmsg. Returns the header size.
+static size_t write_frame(MsgBuffer &bufmsg, const Frame &frame) {
+    uint8_t flags = (frame.message_id ? FRAME_ID : 0) | (frame.deadline_ms ? FRAME_TTL : 0);
+    size_t pos = 0;
+    bufmsg.mtext[pos++] = static_cast<char>(flags);
+    if (flags & FRAME_ID) {
+        std::memcpy(bufmsg.mtext + pos, &frame.message_id, sizeof(frame.message_id));
+        pos += sizeof(frame.message_id);
+    }
+    if (flags & FRAME_TTL) {
+        std::memcpy(bufmsg.mtext + pos, &frame.deadline_ms, sizeof(frame.deadline_ms));
+        pos += sizeof(frame.deadline_ms);
+    }
+    return pos;
+}
+
+// Parse the frame header of a message of len bytes. Returns the header size, or 0 if the
+// message was not framed by this library.
+static size_t read_frame(const MsgBuffer &bufmsg, size_t len, Frame &frame) {
+    frame = Frame();
+    if (len == 0) return 0;
+    uint8_t flags = static_cast<uint8_t>(bufmsg.mtext[0]);
+    if (flags & ~(FRAME_ID | FRAME_TTL)) return 0;
+
+    size_t pos = 1;
+    if (flags & FRAME_ID) {
+        if (len < pos + sizeof(frame.message_id)) return 0;
+        std::memcpy(&frame.message_id, bufmsg.mtext + pos, sizeof(frame.message_id));
+        pos += sizeof(frame.message_id);
+    }
+    if (flags & FRAME_TTL) {
+        if (len < pos + sizeof(frame.deadline_ms)) return 0;
+        std::memcpy(&frame.deadline_ms, bufmsg.mtext + pos, sizeof(frame.deadline_ms));
+        pos += sizeof(frame.deadline_ms);
+    }
+    return pos;
+}
+
+static bool is_expired(const Frame &frame) {
+    return frame.deadline_ms != 0 && monotonicMs() >= frame.deadline_ms;
+}
+
+static void record_expired(int msqid, size_t bytes) {
+    int shmid;
+    ExpiryHeader *counters = expiry_counters(msqid, true, shmid);
+    if (!counters) return;
+    counters->expired_messages.fetch_add(1, std::memory_order_relaxed);
+    counters->expired_bytes.fetch_add(bytes, std::memory_order_relaxed);
+    detachSegment(counters);
+}
+
+// Parse a message taken by a framed receive: sets frame and offset past its frame header.
+// A message without a valid frame header is handed back whole (offset 0): it has already left
+// the queue, so it must not be lost. Returns false, after counting it, if the message has expired.
+static bool accept_message(int msqid, const MsgBuffer &bufmsg, size_t received, Frame &frame, size_t &offset) {
+    offset = read_frame(bufmsg, received, frame);
+    if (!is_expired(frame)) return true;
+    record_expired(msqid, received);
+    return false;
+}
+
+// Hint to the CPU that we are in a spin-wait loop
+static inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    asm volatile("yield" ::: "memory");
+#else
+    asm volatile("" ::: "memory");
+#endif
+}
+
 // --- Static section ---
 MessageQueue MessageQueue::create(key_t key, size_t max_bytes, unsigned short permissions) {
     int msqid = msgget(key, IPC_CREAT | IPC_EXCL | permissions);
     if (msqid == -1) {
         throw std::runtime_error("Failed to create message queue: " + std::string(strerror(errno)));
     }
+    // IPC_EXCL guarantees the queue is ours, so it is removed again if it cannot be sized
     struct msqid_ds buf;
     if (msgctl(msqid, IPC_STAT, &buf) == -1) {
-        throw std::runtime_error("Failed to get queue info after creation: " + std::string(strerror(errno)));
+        std::string error = strerror(errno);
+        msgctl(msqid, IPC_RMID, nullptr);
+        throw std::runtime_error("Failed to get queue info after creation: " + error);
     }
     buf.msg_qbytes = max_bytes;
     if (msgctl(msqid, IPC_SET, &buf) == -1) {
-        throw std::runtime_error("Failed to set queue max bytes: " + std::string(strerror(errno)));
+        std::string error = strerror(errno);
+        msgctl(msqid, IPC_RMID, nullptr);
+        throw std::runtime_error("Failed to set queue max bytes: " + error);
+    }
+
+    // Drop counters left behind by a removed queue that had the same msqid
+    int shmid;
+    ExpiryHeader *stale = expiry_counters(msqid, false, shmid);
+    if (stale) {
+        detachSegment(stale);
+        shmctl(shmid, IPC_RMID, nullptr);
     }
     return MessageQueue(msqid);
 }
@@ -41,59 +214,325 @@ MessageQueue MessageQueue::attach(int msqid) {
 }
 
 void MessageQueue::remove(int msqid) {
+    // Look the expiry counters up while the queue still exists to vouch for them
+    int shmid;
+    ExpiryHeader *counters = expiry_counters(msqid, false, shmid);
+    detachSegment(counters);
+
     if (msgctl(msqid, IPC_RMID, nullptr) == -1) {
         throw std::runtime_error("Failed to remove queue: " + std::string(strerror(errno)));
     }
+    // Best-effort: fails if another user created the counters, and create() cleans up then
+    if (counters) shmctl(shmid, IPC_RMID, nullptr);
 }
 
-void MessageQueue::sendMessage(int msqid, long type, const std::string &message) {
+// Validate a message against the queue limits and copy it into bufmsg, behind a frame header
+// if frame is given. Returns the length on the wire (frame header plus payload).
+static size_t prepare_message(int msqid, long type, const std::string &message, const Frame *frame,
+                              MsgBuffer &bufmsg) {
     if (type <= 0) throw std::invalid_argument("Message type must be positive");
     if (message.empty()) throw std::invalid_argument("Message cannot be empty");
+    if (message.size() > MAX_PAYLOAD) {
+        throw std::length_error("Message length exceeds max buffer size (" + std::to_string(MAX_PAYLOAD) + ")");
+    }
 
     struct msqid_ds buf;
     if (msgctl(msqid, IPC_STAT, &buf) == -1) {
         throw std::runtime_error("Failed to get queue info before sending: " + std::string(strerror(errno)));
     }
     size_t max_bytes = buf.msg_qbytes;
-    size_t msg_len = message.size();
-    if (msg_len > max_bytes) {
+    size_t header = frame ? write_frame(bufmsg, *frame) : 0;
+    size_t msg_len = header + message.size();
+    if (msg_len > max_bytes && header == 0) {
         throw std::length_error("Message length exceeds queue maximum (" + std::to_string(max_bytes) + ")");
     }
-    if (msg_len > sizeof(MsgBuffer::mtext)) {
-        throw std::length_error("Message length exceeds max buffer size (" + std::to_string(sizeof(MsgBuffer::mtext)) + ")");
+    if (msg_len > max_bytes) {
+        throw std::length_error("Message length plus its " + std::to_string(header)
+                                + "-byte frame header exceeds queue maximum (" + std::to_string(max_bytes) + ")");
     }
 
-    MsgBuffer bufmsg;
     bufmsg.mtype = type;
-    std::memset(bufmsg.mtext, 0, sizeof(bufmsg.mtext));
-    std::memcpy(bufmsg.mtext, message.data(), msg_len);
+    std::memcpy(bufmsg.mtext + header, message.data(), message.size());
+    return msg_len;
+}
+
+// Frame header fields for a send with options; the deadline is taken from the clock now
+static Frame frame_for(const SendOptions &options) {
+    Frame frame;
+    frame.message_id = options.message_id;
+    if (options.ttl_ms != 0) frame.deadline_ms = monotonicMs() + options.ttl_ms;
+    return frame;
+}
+
+// Send a message (framed if frame is given) without blocking.
+// Returns false if the queue has no room (EAGAIN); throws on any other failure
+static bool try_send(int msqid, long type, const std::string &message, const Frame *frame) {
+    MsgBuffer bufmsg;
+    size_t msg_len = prepare_message(msqid, type, message, frame, bufmsg);
 
     if (msgsnd(msqid, &bufmsg, msg_len, IPC_NOWAIT) == -1) {
+        if (errno == EAGAIN) return false;
         throw std::runtime_error("Failed to send message: " + std::string(strerror(errno)));
     }
+    return true;
+}
+
+// Send a message (framed if frame is given) without blocking; throws on any failure including
+// a full queue
+static void send_message(int msqid, long type, const std::string &message, const Frame *frame) {
+    if (!try_send(msqid, type, message, frame)) {
+        throw std::runtime_error("Failed to send message: " + std::string(strerror(EAGAIN)));
+    }
+}
+
+void MessageQueue::sendMessage(int msqid, long type, const std::string &message) {
+    send_message(msqid, type, message, nullptr);
+}
+
+void MessageQueue::sendMessage(int msqid, long type, const std::string &message, const SendOptions &options) {
+    Frame frame = frame_for(options);
+    send_message(msqid, type, message, &frame);
+}
+
+bool MessageQueue::trySendMessage(int msqid, long type, const std::string &message) {
+    return try_send(msqid, type, message, nullptr);
+}
+
+bool MessageQueue::trySendMessage(int msqid, long type, const std::string &message, const SendOptions &options) {
+    Frame frame = frame_for(options);
+    return try_send(msqid, type, message, &frame);
+}
+
+// Receive the next message into bufmsg and set len to its payload length. A plain receive takes
+// the message as it is (offset 0). A framed receive sets frame and offset past the frame header
+// and discards expired TTL messages on the way. Returns false if nowait is set and no message is
+// present. Every consumed message, live or expired, is released from quota if one is given.
+// The whole buffer is offered to msgrcv rather than the queue's msg_qbytes: messages queued
+// before msg_qbytes was lowered are larger than the current limit and must still be received.
+static bool receive_message(int msqid, long type, bool nowait, bool framed, MsgBuffer &bufmsg, Frame &frame,
+                            size_t &offset, size_t &len, TypeQuota *quota = nullptr) {
+    if (type < 0) throw std::invalid_argument("Message type cannot be negative");
+
+    // Expired messages are dropped in a tight loop; msgrcv only blocks once the queue
+    // holds nothing of the requested type
+    int flags = nowait ? IPC_NOWAIT : 0;
+    for (;;) {
+        ssize_t received = msgrcv(msqid, &bufmsg, sizeof(bufmsg.mtext), type, flags);
+        if (received == -1) {
+            if (errno == ENOMSG && nowait) return false;
+            throw std::runtime_error("Failed to receive message: " + std::string(strerror(errno)));
+        }
+        if (quota) quota->release(bufmsg.mtype, received);
+
+        frame = Frame();
+        offset = 0;
+        if (!framed || accept_message(msqid, bufmsg, received, frame, offset)) {
+            len = static_cast<size_t>(received) - offset;
+            return true;
+        }
+    }
 }
 
 std::string MessageQueue::receiveMessage(int msqid, long type, bool nowait) {
-    if (type <= 0) throw std::invalid_argument("Message type must be positive");
+    MsgBuffer bufmsg;
+    Frame frame;
+    size_t offset, len;
+    if (!receive_message(msqid, type, nowait, false, bufmsg, frame, offset, len)) {
+        throw std::runtime_error("No message of the requested type in the queue.");
+    }
+    return std::string(bufmsg.mtext + offset, len);
+}
 
-    struct msqid_ds buf;
-    if (msgctl(msqid, IPC_STAT, &buf) == -1) {
-        throw std::runtime_error("Failed to get queue info before receiving: " + std::string(strerror(errno)));
+std::string MessageQueue::receiveMessageFramed(int msqid, long type, bool nowait) {
+    MsgBuffer bufmsg;
+    Frame frame;
+    size_t offset, len;
+    if (!receive_message(msqid, type, nowait, true, bufmsg, frame, offset, len)) {
+        throw std::runtime_error("No message of the requested type in the queue.");
     }
-    size_t max_bytes = buf.msg_qbytes;
-    size_t bufsize = std::min(max_bytes, sizeof(MsgBuffer::mtext));
+    return std::string(bufmsg.mtext + offset, len);
+}
 
+bool MessageQueue::tryReceiveMessage(int msqid, long type, std::string &message) {
     MsgBuffer bufmsg;
-    std::memset(&bufmsg, 0, sizeof(bufmsg));
+    Frame frame;
+    size_t offset, len;
+    if (!receive_message(msqid, type, true, false, bufmsg, frame, offset, len)) return false;
+    message.assign(bufmsg.mtext + offset, len);
+    return true;
+}
 
-    int flags = nowait ? IPC_NOWAIT : 0;
-    ssize_t received = msgrcv(msqid, &bufmsg, bufsize, type, flags);
-    if (received == -1) {
-        if (errno == ENOMSG && nowait)
+// Quota-checked send of a message (framed if frame is given), retrying for up to wait_ms
+static SendStatus try_send_quota(int msqid, long type, const std::string &message, const Frame *frame,
+                                 TypeQuota &quota, unsigned int wait_ms) {
+    MsgBuffer bufmsg;
+    size_t msg_len = prepare_message(msqid, type, message, frame, bufmsg);
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(wait_ms);
+    for (;;) {
+        // Retries do not count as rejections; only the final outcome of the call does
+        SendStatus status = SendStatus::OverQuota;
+        if (quota.tryAcquire(type, msg_len, false)) {
+            if (msgsnd(msqid, &bufmsg, msg_len, IPC_NOWAIT) == 0) return SendStatus::Sent;
+            int err = errno;
+            quota.cancel(type, msg_len);
+            if (err != EAGAIN) {
+                throw std::runtime_error("Failed to send message: " + std::string(strerror(err)));
+            }
+            status = SendStatus::QueueFull;
+        }
+        if (std::chrono::steady_clock::now() >= deadline) {
+            if (status == SendStatus::OverQuota) quota.countRejection(type);
+            return status;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+}
+
+SendStatus MessageQueue::trySendMessageQuota(int msqid, long type, const std::string &message,
+                                             TypeQuota &quota, unsigned int wait_ms) {
+    return try_send_quota(msqid, type, message, nullptr, quota, wait_ms);
+}
+
+SendStatus MessageQueue::trySendMessageQuota(int msqid, long type, const std::string &message,
+                                             TypeQuota &quota, unsigned int wait_ms, const SendOptions &options) {
+    Frame frame = frame_for(options);
+    return try_send_quota(msqid, type, message, &frame, quota, wait_ms);
+}
+
+std::string MessageQueue::receiveMessageQuota(int msqid, long type, TypeQuota &quota, bool nowait, bool framed) {
+    MsgBuffer bufmsg;
+    Frame frame;
+    size_t offset, len;
+    if (!receive_message(msqid, type, nowait, framed, bufmsg, frame, offset, len, &quota)) {
+        throw std::runtime_error("No message of the requested type in the queue.");
+    }
+    return std::string(bufmsg.mtext + offset, len);
+}
+
+std::string MessageQueue::receiveMessageSpin(int msqid, long type, unsigned int spin_us) {
+    MsgBuffer bufmsg;
+    Frame frame;
+    size_t offset, len;
+
+    // Spin phase: poll without blocking until the budget is spent, then fall back to a
+    // blocking receive
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(spin_us);
+    bool received = false;
+    while (spin_us > 0) {
+        received = receive_message(msqid, type, true, false, bufmsg, frame, offset, len);
+        if (received || std::chrono::steady_clock::now() >= deadline) break;
+        cpu_relax();
+    }
+    if (!received) receive_message(msqid, type, false, false, bufmsg, frame, offset, len);
+    return std::string(bufmsg.mtext + offset, len);
+}
+
+void MessageQueue::sendMessageWithTtl(int msqid, long type, const std::string &message, unsigned int ttl_ms) {
+    if (ttl_ms == 0) throw std::invalid_argument("Message TTL must be positive");
+
+    SendOptions options;
+    options.ttl_ms = ttl_ms;
+    sendMessage(msqid, type, message, options);
+}
+
+// How long reapExpired waits for room to put back a live message it took by mistake
+static const unsigned int REQUEUE_WAIT_MS = 1000;
+
+size_t MessageQueue::reapExpired(int msqid, TypeQuota *quota) {
+#ifdef MSG_COPY
+    MsgBuffer peeked;
+    MsgBuffer taken;
+    std::unordered_set<long> live_types;
+    size_t reaped = 0;
+
+    // Peek at each message by position with MSG_COPY (the queue is left untouched), and remove
+    // an expired one only when it is the oldest of its type, so that a receive by type takes
+    // exactly that message
+    for (long index = 0;;) {
+        ssize_t peeked_len = msgrcv(msqid, &peeked, sizeof(peeked.mtext), index, IPC_NOWAIT | MSG_COPY | MSG_NOERROR);
+        if (peeked_len == -1) {
+            if (errno == ENOMSG) break;
+            if (errno == ENOSYS) throw std::runtime_error("Reaping requires MSG_COPY support (CONFIG_CHECKPOINT_RESTORE)");
+            throw std::runtime_error("Failed to peek message: " + std::string(strerror(errno)));
+        }
+
+        // Messages not framed by this library are treated as live
+        Frame frame;
+        bool expired = read_frame(peeked, peeked_len, frame) != 0 && is_expired(frame);
+        if (!expired || live_types.count(peeked.mtype)) {
+            live_types.insert(peeked.mtype);
+            ++index;
+            continue;
+        }
+
+        ssize_t taken_len = msgrcv(msqid, &taken, sizeof(taken.mtext), peeked.mtype, IPC_NOWAIT);
+        if (taken_len == -1) {
+            if (errno == ENOMSG) continue;                  // A consumer got there first: peek again
+            if (errno == E2BIG) { ++index; continue; }      // Not one of ours: larger than any framed message
+            throw std::runtime_error("Failed to remove expired message: " + std::string(strerror(errno)));
+        }
+        if (read_frame(taken, taken_len, frame) == 0 || !is_expired(frame)) {
+            // Raced with a consumer and took a live message: put it back (at the tail) and stop
+            // this pass. Producers may have used the freed space meanwhile, so poll for room, but
+            // only for a bounded time so that a reaper thread can always be stopped.
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(REQUEUE_WAIT_MS);
+            while (msgsnd(msqid, &taken, taken_len, IPC_NOWAIT) == -1) {
+                if (errno != EAGAIN && errno != EINTR) {
+                    throw std::runtime_error("Failed to requeue live message: " + std::string(strerror(errno)));
+                }
+                if (std::chrono::steady_clock::now() >= deadline) {
+                    throw std::runtime_error("Dropped a live message of type " + std::to_string(taken.mtype)
+                                             + ": the queue stayed full for " + std::to_string(REQUEUE_WAIT_MS)
+                                             + " ms while it was being requeued");
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            break;
+        }
+        if (quota) quota->release(taken.mtype, taken_len);
+        record_expired(msqid, taken_len);
+        ++reaped;
+    }
+    return reaped;
+#else
+    (void)msqid;
+    (void)quota;
+    throw std::runtime_error("Reaping requires MSG_COPY support");
+#endif
+}
+
+ExpiryStats MessageQueue::getExpiryStats(int msqid) {
+    ExpiryStats stats{msqid, 0, 0};
+    int shmid;
+    ExpiryHeader *counters = expiry_counters(msqid, false, shmid);
+    if (counters) {
+        stats.expired_messages = counters->expired_messages.load(std::memory_order_relaxed);
+        stats.expired_bytes = counters->expired_bytes.load(std::memory_order_relaxed);
+        detachSegment(counters);
+    }
+    return stats;
+}
+
+void MessageQueue::sendMessageWithId(int msqid, long type, const std::string &message, uint64_t message_id) {
+    if (message_id == 0) throw std::invalid_argument("Message id 0 is reserved");
+
+    SendOptions options;
+    options.message_id = message_id;
+    sendMessage(msqid, type, message, options);
+}
+
+std::string MessageQueue::receiveMessageDedup(int msqid, long type, DedupFilter &filter, bool nowait) {
+    MsgBuffer bufmsg;
+    Frame frame;
+    size_t offset, len;
+    for (;;) {
+        if (!receive_message(msqid, type, nowait, true, bufmsg, frame, offset, len)) {
             throw std::runtime_error("No message of the requested type in the queue.");
-        throw std::runtime_error("Failed to receive message: " + std::string(strerror(errno)));
+        }
+        if (frame.message_id != 0 && filter.checkAndInsert(frame.message_id)) continue;
+        return std::string(bufmsg.mtext + offset, len);
     }
-    return std::string(bufmsg.mtext, received);
 }
 
 void MessageQueue::setMaxBytes(int msqid, size_t max_bytes) {
@@ -107,12 +546,14 @@ void MessageQueue::setMaxBytes(int msqid, size_t max_bytes) {
     }
 }
 
-QueueInfo MessageQueue::getInfo(int msqid) {
-    struct msqid_ds buf;
-    if (msgctl(msqid, IPC_STAT, &buf) == -1) {
-        throw std::runtime_error("Failed to get queue info: " + std::string(strerror(errno)));
-    }
+// MSG_STAT_ANY (Linux 4.17+) ignores read permission; fall back to MSG_STAT on older headers
+#ifdef MSG_STAT_ANY
+static const int MSG_STAT_CMD = MSG_STAT_ANY;
+#else
+static const int MSG_STAT_CMD = MSG_STAT;
+#endif
 
+static QueueInfo toQueueInfo(int msqid, const struct msqid_ds &buf) {
     QueueInfo info;
     info.msqid = msqid;
     info.key = buf.msg_perm.__key;
@@ -128,6 +569,66 @@ QueueInfo MessageQueue::getInfo(int msqid) {
     return info;
 }
 
+// Walk the kernel's queue index, calling fn(info) for each live queue until it returns false
+template <typename Fn>
+static void forEachQueue(Fn fn) {
+    struct msginfo msginfo;
+    int max_index = msgctl(0, MSG_INFO, reinterpret_cast<struct msqid_ds *>(&msginfo));
+    if (max_index == -1) {
+        throw std::runtime_error("Failed to get message queue index: " + std::string(strerror(errno)));
+    }
+
+    // Kernels before 4.17 reject MSG_STAT_ANY with EINVAL for every index, which looks just like
+    // an empty index. If nothing could be stat'ed although MSG_INFO counts queues in use, walk
+    // again with MSG_STAT, which lists the queues we may read.
+    int cmd = MSG_STAT_CMD;
+    for (;;) {
+        bool stated = false;
+        for (int index = 0; index <= max_index; ++index) {
+            struct msqid_ds buf;
+            int msqid = msgctl(index, cmd, &buf);
+            if (msqid == -1) {
+                // Unused slot, queue removed mid-walk, or no permission: skip it
+                if (errno == EINVAL || errno == EIDRM || errno == EACCES) continue;
+                throw std::runtime_error("Failed to stat message queue: " + std::string(strerror(errno)));
+            }
+            stated = true;
+            if (!fn(toQueueInfo(msqid, buf))) return;
+        }
+        if (stated || cmd == MSG_STAT || msginfo.msgpool <= 0) return;
+        cmd = MSG_STAT;
+    }
+}
+
+QueueInfo MessageQueue::getInfo(int msqid) {
+    struct msqid_ds buf;
+    if (msgctl(msqid, IPC_STAT, &buf) == -1) {
+        throw std::runtime_error("Failed to get queue info: " + std::string(strerror(errno)));
+    }
+    return toQueueInfo(msqid, buf);
+}
+
+std::vector<QueueInfo> MessageQueue::listAll() {
+    std::vector<QueueInfo> queues;
+    forEachQueue([&](const QueueInfo &info) {
+        queues.push_back(info);
+        return true;
+    });
+    return queues;
+}
+
+std::optional<QueueInfo> MessageQueue::findByKey(key_t key) {
+    if (key == IPC_PRIVATE) throw std::invalid_argument("IPC_PRIVATE queues have no key to look up");
+
+    std::optional<QueueInfo> found;
+    forEachQueue([&](const QueueInfo &info) {
+        if (info.key != key) return true;
+        found = info;
+        return false;
+    });
+    return found;
+}
+
 // --- Non-static (object) section ---
 MessageQueue::MessageQueue(int msqid)
     : msqid_(msqid)
@@ -137,10 +638,68 @@ void MessageQueue::sendMessage(long type, const std::string &message) {
     sendMessage(msqid_, type, message);
 }
 
+bool MessageQueue::trySendMessage(long type, const std::string &message) {
+    return trySendMessage(msqid_, type, message);
+}
+
+void MessageQueue::sendMessage(long type, const std::string &message, const SendOptions &options) {
+    sendMessage(msqid_, type, message, options);
+}
+
+bool MessageQueue::trySendMessage(long type, const std::string &message, const SendOptions &options) {
+    return trySendMessage(msqid_, type, message, options);
+}
+
 std::string MessageQueue::receiveMessage(long type, bool nowait) {
     return receiveMessage(msqid_, type, nowait);
 }
 
+SendStatus MessageQueue::trySendMessageQuota(long type, const std::string &message, TypeQuota &quota,
+                                             unsigned int wait_ms) {
+    return trySendMessageQuota(msqid_, type, message, quota, wait_ms);
+}
+
+SendStatus MessageQueue::trySendMessageQuota(long type, const std::string &message, TypeQuota &quota,
+                                             unsigned int wait_ms, const SendOptions &options) {
+    return trySendMessageQuota(msqid_, type, message, quota, wait_ms, options);
+}
+
+std::string MessageQueue::receiveMessageQuota(long type, TypeQuota &quota, bool nowait, bool framed) {
+    return receiveMessageQuota(msqid_, type, quota, nowait, framed);
+}
+
+std::string MessageQueue::receiveMessageFramed(long type, bool nowait) {
+    return receiveMessageFramed(msqid_, type, nowait);
+}
+
+void MessageQueue::sendMessageWithTtl(long type, const std::string &message, unsigned int ttl_ms) {
+    sendMessageWithTtl(msqid_, type, message, ttl_ms);
+}
+
+size_t MessageQueue::reapExpired(TypeQuota *quota) {
+    return reapExpired(msqid_, quota);
+}
+
+ExpiryStats MessageQueue::getExpiryStats() const {
+    return getExpiryStats(msqid_);
+}
+
+bool MessageQueue::tryReceiveMessage(long type, std::string &message) {
+    return tryReceiveMessage(msqid_, type, message);
+}
+
+std::string MessageQueue::receiveMessageSpin(long type, unsigned int spin_us) {
+    return receiveMessageSpin(msqid_, type, spin_us);
+}
+
+void MessageQueue::sendMessageWithId(long type, const std::string &message, uint64_t message_id) {
+    sendMessageWithId(msqid_, type, message, message_id);
+}
+
+std::string MessageQueue::receiveMessageDedup(long type, DedupFilter &filter, bool nowait) {
+    return receiveMessageDedup(msqid_, type, filter, nowait);
+}
+
 void MessageQueue::setMaxBytes(size_t max_bytes) {
     setMaxBytes(msqid_, max_bytes);
 }
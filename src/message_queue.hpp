@@ -1,9 +1,36 @@
 #pragma once
 
 #include <string>
+#include <vector>
+#include <optional>
 #include <stdexcept>
+#include <cstdint>
 #include <sys/types.h>
 
+// Expired-message counters for a queue, shared by all processes
+struct ExpiryStats {
+    int msqid;                   // Message queue ID
+    uint64_t expired_messages;   // Expired messages discarded by receives and reaping
+    uint64_t expired_bytes;      // Bytes of those messages (including frame headers)
+};
+
+// Fields of a framed send. Every send given SendOptions is framed, even with both fields left
+// at 0, so producers of a framed queue can also send messages without an id or a deadline.
+struct SendOptions {
+    uint64_t message_id = 0;     // Non-zero: tag the message for receiveMessageDedup
+    unsigned int ttl_ms = 0;     // Non-zero: the message expires ttl_ms milliseconds after sending
+};
+
+class DedupFilter;
+class TypeQuota;
+
+// Outcome of a quota-checked send
+enum class SendStatus {
+    Sent,        // Message is in the queue
+    QueueFull,   // Admitted by the quota, but the queue had no room (EAGAIN)
+    OverQuota    // Rejected by the per-type quota
+};
+
 // Structure to hold detailed information about a message queue
 struct QueueInfo {
     int msqid;                   // Message queue ID
@@ -19,6 +46,13 @@ struct QueueInfo {
     time_t last_change_time;     // Time of last change
 };
 
+// Messages are sent and received as-is, so queues interoperate with any other System V program.
+// Message ids and TTLs are opt-in per queue: they travel in a small frame header (1 byte, plus
+// 8 bytes each for the id and the deadline) that counts toward msg_qbytes. On a framed queue,
+// producers send through the overloads that take SendOptions (or sendMessageWithId and
+// sendMessageWithTtl), and consumers receive with receiveMessageFramed, receiveMessageDedup or receiveMessageQuota
+// with framed set, which strip the header again. A framed receive hands back a message without
+// a valid frame header unchanged; a plain receive hands back framed messages header and all.
 class MessageQueue {
 public:
     // Static factory method: create a new queue
@@ -33,11 +67,92 @@ public:
     // Throws std::runtime_error on failure
     static void sendMessage(int msqid, long type, const std::string &message);
 
-    // Receive a message from the queue.
+    // Send a framed message carrying the id and TTL in options
+    // Throws std::runtime_error on failure
+    static void sendMessage(int msqid, long type, const std::string &message, const SendOptions &options);
+
+    // Send a message without throwing when the queue is full.
+    // Returns false if the queue has no room (EAGAIN), true if the message was sent.
+    // Throws std::runtime_error on any other failure
+    static bool trySendMessage(int msqid, long type, const std::string &message);
+
+    // Send a framed message carrying the id and TTL in options, without throwing when the queue
+    // is full (returns false on EAGAIN).
+    // Throws std::runtime_error on any other failure
+    static bool trySendMessage(int msqid, long type, const std::string &message, const SendOptions &options);
+
+    // Send a message if its type is within its quota (see TypeQuota). Never throws for a full queue
+    // or an exhausted quota; if wait_ms is non-zero, retries for up to wait_ms milliseconds first.
+    // Throws std::runtime_error on any other failure
+    static SendStatus trySendMessageQuota(int msqid, long type, const std::string &message,
+                                          TypeQuota &quota, unsigned int wait_ms = 0);
+
+    // Quota-checked send of a framed message carrying the id and TTL in options
+    // Throws std::runtime_error on failure other than a full queue or an exhausted quota
+    static SendStatus trySendMessageQuota(int msqid, long type, const std::string &message,
+                                          TypeQuota &quota, unsigned int wait_ms, const SendOptions &options);
+
+    // Receive a message from the queue. A type of 0 receives the first message of any type.
     // By default, blocks until a message is available. If nowait is true, returns immediately with an exception if no message is present.
     // Throws std::runtime_error on failure or if no message is present in non-blocking mode.
     static std::string receiveMessage(int msqid, long type, bool nowait = false);
 
+    // Receive a message from a framed queue: strips the frame header and silently discards
+    // messages whose TTL has passed (see sendMessageWithTtl).
+    // Throws std::runtime_error on failure or if no message is present in non-blocking mode.
+    static std::string receiveMessageFramed(int msqid, long type, bool nowait = false);
+
+    // Receive a message without blocking or throwing when the queue is empty.
+    // Returns false if no message of the requested type is present. Costs a single msgrcv.
+    // Throws std::runtime_error on any other failure
+    static bool tryReceiveMessage(int msqid, long type, std::string &message);
+
+    // Receive a message and release its bytes from the sender's type quota. If framed is set,
+    // the message is received like receiveMessageFramed.
+    // Throws std::runtime_error on failure or if no message is present in non-blocking mode.
+    static std::string receiveMessageQuota(int msqid, long type, TypeQuota &quota, bool nowait = false,
+                                           bool framed = false);
+
+    // Receive a message, busy-polling with IPC_NOWAIT for up to spin_us microseconds before
+    // falling back to a blocking receive. Trades CPU time for lower wake-up latency.
+    // A spin_us of 0 behaves like a plain blocking receive.
+    // Throws std::runtime_error on failure, including an interrupted wait, like receiveMessage
+    static std::string receiveMessageSpin(int msqid, long type, unsigned int spin_us);
+
+    // Send a message tagged with a 64-bit message id (opt-in deduplication).
+    // Retrying with the same id lets receiveMessageDedup drop the duplicate.
+    // Throws std::invalid_argument if message_id is 0, std::runtime_error on failure
+    static void sendMessageWithId(int msqid, long type, const std::string &message, uint64_t message_id);
+
+    // Receive a message from a framed queue like receiveMessageFramed, silently discarding
+    // messages whose id the shared filter has already seen. Messages sent without an id are
+    // passed through unchanged.
+    // Throws std::runtime_error on failure or if no message is present in non-blocking mode.
+    static std::string receiveMessageDedup(int msqid, long type, DedupFilter &filter, bool nowait = false);
+
+    // Send a message that expires ttl_ms milliseconds from now. Framed receives discard it once expired.
+    // Throws std::invalid_argument if ttl_ms is 0, std::runtime_error on failure
+    static void sendMessageWithTtl(int msqid, long type, const std::string &message, unsigned int ttl_ms);
+
+    // Remove expired TTL messages from a framed queue without receiving live ones, so that expired
+    // bytes stop holding msg_qbytes space on idle queues. Returns the number removed.
+    // Only messages that are first of their type in the queue can be removed: msgrcv takes the
+    // oldest message of a type, so an expired message behind a live one of the same type stays
+    // until framed receives reach it or the live message has been consumed.
+    // If a consumer races the reaper, the reaper may take a live message instead; it then sends
+    // it back, so the message moves to the tail of the queue (behind newer messages of its type).
+    // If the queue stays full for a second meanwhile, the message is lost and this throws.
+    // Requires kernel MSG_COPY support. Throws std::runtime_error on failure
+    // If quota is given, the bytes of removed messages are released from it.
+    static size_t reapExpired(int msqid, TypeQuota *quota = nullptr);
+
+    // Get counters of expired messages discarded from the queue by any process (receives and
+    // reaping). The counters live in a shared memory segment of the queue (System V key
+    // 0x80000000 | msqid), created by the first expiry recorded by a process of the queue's
+    // owner or creator and removed by remove(). They are best-effort: they stay at zero if the
+    // segment does not exist or cannot be attached.
+    static ExpiryStats getExpiryStats(int msqid);
+
     // Change maximum allowed bytes for the queue
     // Throws std::runtime_error on failure
     static void setMaxBytes(int msqid, size_t max_bytes);
@@ -50,17 +165,85 @@ public:
     // Throws std::runtime_error on failure
     static QueueInfo getInfo(int msqid);
 
+    // List all message queues in the system (single MSG_INFO/MSG_STAT_ANY index walk,
+    // no per-queue msgget). Queues that vanish during the walk are skipped. On kernels without
+    // MSG_STAT_ANY, only the queues the caller may read are listed.
+    // Throws std::runtime_error on failure
+    static std::vector<QueueInfo> listAll();
+
+    // Find the queue created with the given key, without calling msgget.
+    // Returns std::nullopt if no such queue exists.
+    // Throws std::invalid_argument for IPC_PRIVATE (such queues share key 0 but are unrelated),
+    // std::runtime_error on failure
+    static std::optional<QueueInfo> findByKey(key_t key);
+
     // --- Non-static (object) variants ---
 
     // Send a message to the queue
     // Throws std::runtime_error on failure
     void sendMessage(long type, const std::string &message);
 
-    // Receive a message from the queue.
+    // Send a framed message carrying the id and TTL in options
+    // Throws std::runtime_error on failure
+    void sendMessage(long type, const std::string &message, const SendOptions &options);
+
+    // Send a message without throwing when the queue is full (returns false on EAGAIN)
+    // Throws std::runtime_error on any other failure
+    bool trySendMessage(long type, const std::string &message);
+
+    // Send a framed message without throwing when the queue is full (returns false on EAGAIN)
+    // Throws std::runtime_error on any other failure
+    bool trySendMessage(long type, const std::string &message, const SendOptions &options);
+
+    // Send a message if its type is within its quota, optionally waiting up to wait_ms
+    // Throws std::runtime_error on failure
+    SendStatus trySendMessageQuota(long type, const std::string &message, TypeQuota &quota, unsigned int wait_ms = 0);
+
+    // Quota-checked send of a framed message carrying the id and TTL in options
+    // Throws std::runtime_error on failure
+    SendStatus trySendMessageQuota(long type, const std::string &message, TypeQuota &quota, unsigned int wait_ms,
+                                   const SendOptions &options);
+
+    // Receive a message from the queue. A type of 0 receives the first message of any type.
     // By default, blocks until a message is available. If nowait is true, returns immediately with an exception if no message is present.
     // Throws std::runtime_error on failure or if no message is present in non-blocking mode.
     std::string receiveMessage(long type, bool nowait = false);
 
+    // Receive a message without blocking or throwing when the queue is empty (returns false)
+    // Throws std::runtime_error on any other failure
+    bool tryReceiveMessage(long type, std::string &message);
+
+    // Receive a message and release its bytes from the sender's type quota
+    // Throws std::runtime_error on failure or if no message is present in non-blocking mode.
+    std::string receiveMessageQuota(long type, TypeQuota &quota, bool nowait = false, bool framed = false);
+
+    // Receive a message from a framed queue, discarding expired messages
+    // Throws std::runtime_error on failure or if no message is present in non-blocking mode.
+    std::string receiveMessageFramed(long type, bool nowait = false);
+
+    // Receive a message, busy-polling for up to spin_us microseconds before blocking.
+    // Throws std::runtime_error on failure
+    std::string receiveMessageSpin(long type, unsigned int spin_us);
+
+    // Send a message tagged with a 64-bit message id
+    // Throws std::runtime_error on failure
+    void sendMessageWithId(long type, const std::string &message, uint64_t message_id);
+
+    // Receive a message, discarding duplicates seen by the shared filter
+    // Throws std::runtime_error on failure or if no message is present in non-blocking mode.
+    std::string receiveMessageDedup(long type, DedupFilter &filter, bool nowait = false);
+
+    // Send a message that expires ttl_ms milliseconds from now
+    // Throws std::runtime_error on failure
+    void sendMessageWithTtl(long type, const std::string &message, unsigned int ttl_ms);
+
+    // Remove expired TTL messages from the queue. Returns the number removed.
+    // Throws std::runtime_error on failure
+    size_t reapExpired(TypeQuota *quota = nullptr);
+
+    // Get counters of expired messages discarded from the queue by any process
+    ExpiryStats getExpiryStats() const;
+
     // Change maximum allowed bytes for the queue
     // Throws std::runtime_error on failure
     void setMaxBytes(size_t max_bytes);
@@ -0,0 +1,291 @@
+#include "message_quota.hpp"
+#include "ipc_internal.hpp"
+
+#include <atomic>
+#include <thread>
+#include <string>
+#include <algorithm>
+
+// --- Shared memory layout ---
+
+static const uint32_t QUOTA_MAGIC = 0x51554f54;  // "QUOT"
+
+static_assert(std::atomic<long>::is_always_lock_free, "shared slot types must be lock-free");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared limits must be lock-free");
+
+struct QuotaSlot {
+    std::atomic<long> type;      // 0 = free slot
+    std::atomic<uint32_t> lock;  // Guards every field below
+    uint32_t configured;
+    uint64_t cap_bytes;
+    uint64_t rate_bytes_per_s;
+    uint64_t burst_bytes;
+    int64_t inflight_bytes;
+    double tokens;
+    uint64_t last_refill_ns;     // 0 = token bucket not started yet
+    uint64_t sent;
+    uint64_t rejected;
+};
+
+struct QuotaHeader {
+    ShmSegmentHeader segment;    // segment.num_slots is the number of QuotaSlots
+    std::atomic<uint64_t> default_cap_bytes;
+    std::atomic<uint64_t> default_rate_bytes_per_s;
+    std::atomic<uint64_t> default_burst_bytes;
+};
+
+static QuotaHeader *header_of(void *addr) {
+    return static_cast<QuotaHeader *>(addr);
+}
+
+static QuotaSlot *slots_of(void *addr) {
+    return reinterpret_cast<QuotaSlot *>(static_cast<char *>(addr) + sizeof(QuotaHeader));
+}
+
+// Scoped per-slot spinlock (shared memory cannot hold a std::mutex portably)
+class SlotLock {
+public:
+    explicit SlotLock(QuotaSlot &slot) : slot_(slot) {
+        while (slot_.lock.exchange(1, std::memory_order_acquire) != 0) {
+            std::this_thread::yield();
+        }
+    }
+    ~SlotLock() { slot_.lock.store(0, std::memory_order_release); }
+
+private:
+    QuotaSlot &slot_;
+};
+
+// Find the slot for type with linear probing; claims a free slot if claim is true.
+// Returns nullptr if the type is not tracked and claim is false, or if the table is full.
+static QuotaSlot *find_slot(void *addr, uint64_t n, long type, bool claim) {
+    if (type <= 0) throw std::invalid_argument("Message type must be positive");
+
+    QuotaSlot *slots = slots_of(addr);
+    uint64_t start = (static_cast<uint64_t>(type) * 0x9e3779b97f4a7c15ULL) % n;
+    for (uint64_t i = 0; i < n; ++i) {
+        QuotaSlot &slot = slots[(start + i) % n];
+        long current = slot.type.load(std::memory_order_acquire);
+        if (current == type) return &slot;
+        if (current == 0) {
+            if (!claim) return nullptr;
+            if (slot.type.compare_exchange_strong(current, type, std::memory_order_acq_rel)) return &slot;
+            if (current == type) return &slot;  // Another process claimed it for the same type
+        }
+    }
+    return nullptr;
+}
+
+static std::runtime_error table_full(uint64_t n) {
+    return std::runtime_error("Quota table is full (" + std::to_string(n) + " types)");
+}
+
+static bool has_limit(const QuotaLimit &limit) {
+    return limit.cap_bytes || limit.rate_bytes_per_s;
+}
+
+// Limit that applies to a slot: its own if configured, otherwise the table default
+static QuotaLimit effective_limit(void *addr, const QuotaSlot &slot) {
+    QuotaLimit limit;
+    if (slot.configured) {
+        limit.cap_bytes = slot.cap_bytes;
+        limit.rate_bytes_per_s = slot.rate_bytes_per_s;
+        limit.burst_bytes = slot.burst_bytes;
+    } else {
+        const QuotaHeader *hdr = header_of(addr);
+        limit.cap_bytes = hdr->default_cap_bytes.load(std::memory_order_relaxed);
+        limit.rate_bytes_per_s = hdr->default_rate_bytes_per_s.load(std::memory_order_relaxed);
+        limit.burst_bytes = hdr->default_burst_bytes.load(std::memory_order_relaxed);
+    }
+    if (limit.rate_bytes_per_s && !limit.burst_bytes) limit.burst_bytes = limit.rate_bytes_per_s;
+    return limit;
+}
+
+// --- Static section ---
+TypeQuota TypeQuota::open(key_t key, size_t max_types, unsigned short permissions) {
+    if (max_types == 0) throw std::invalid_argument("Quota table size must be positive");
+
+    size_t size = sizeof(QuotaHeader) + max_types * sizeof(QuotaSlot);
+    int shmid;
+    void *addr = createSegment(key, size, permissions, "quota table", shmid);
+    if (!addr) return attach(key);
+
+    // New segments are zero-filled: every slot free, no default limit
+    publishSegment(addr, QUOTA_MAGIC, max_types);
+    return TypeQuota(shmid, addr, max_types);
+}
+
+TypeQuota TypeQuota::attach(key_t key) {
+    int shmid;
+    uint64_t num_slots;
+    void *addr = attachSegment(key, QUOTA_MAGIC, sizeof(QuotaHeader), sizeof(QuotaSlot), "quota table", shmid, num_slots);
+    return TypeQuota(shmid, addr, num_slots);
+}
+
+// --- Non-static (object) section ---
+TypeQuota::TypeQuota(int shmid, void *addr, uint64_t num_slots)
+    : shmid_(shmid), addr_(addr), num_slots_(num_slots)
+{}
+
+TypeQuota::~TypeQuota() {
+    detachSegment(addr_);
+}
+
+TypeQuota::TypeQuota(TypeQuota&& other) noexcept
+    : shmid_(other.shmid_), addr_(other.addr_), num_slots_(other.num_slots_)
+{
+    other.addr_ = nullptr;
+}
+
+TypeQuota& TypeQuota::operator=(TypeQuota&& other) noexcept {
+    if (this != &other) {
+        detachSegment(addr_);
+        shmid_ = other.shmid_;
+        addr_ = other.addr_;
+        num_slots_ = other.num_slots_;
+        other.addr_ = nullptr;
+    }
+    return *this;
+}
+
+void TypeQuota::setLimit(long type, const QuotaLimit &limit) {
+    QuotaSlot *found = find_slot(addr_, num_slots_, type, true);
+    if (!found) throw table_full(num_slots_);
+    QuotaSlot &slot = *found;
+    SlotLock lock(slot);
+    slot.configured = 1;
+    slot.cap_bytes = limit.cap_bytes;
+    slot.rate_bytes_per_s = limit.rate_bytes_per_s;
+    slot.burst_bytes = limit.burst_bytes;
+    slot.last_refill_ns = 0;  // Restart the token bucket with a full burst
+}
+
+void TypeQuota::setDefaultLimit(const QuotaLimit &limit) {
+    QuotaHeader *hdr = header_of(addr_);
+    hdr->default_cap_bytes.store(limit.cap_bytes, std::memory_order_relaxed);
+    hdr->default_rate_bytes_per_s.store(limit.rate_bytes_per_s, std::memory_order_relaxed);
+    hdr->default_burst_bytes.store(limit.burst_bytes, std::memory_order_relaxed);
+}
+
+QuotaLimit TypeQuota::getDefaultLimit() const {
+    const QuotaHeader *hdr = header_of(addr_);
+    QuotaLimit limit;
+    limit.cap_bytes = hdr->default_cap_bytes.load(std::memory_order_relaxed);
+    limit.rate_bytes_per_s = hdr->default_rate_bytes_per_s.load(std::memory_order_relaxed);
+    limit.burst_bytes = hdr->default_burst_bytes.load(std::memory_order_relaxed);
+    return limit;
+}
+
+bool TypeQuota::tryAcquire(long type, size_t bytes, bool count_rejection) {
+    // Only claim a slot when the default limit needs per-type counters: otherwise types
+    // without a limit of their own are admitted untracked and never fill the table
+    QuotaSlot *found = find_slot(addr_, num_slots_, type, false);
+    if (!found) {
+        if (!has_limit(getDefaultLimit())) return true;
+        found = find_slot(addr_, num_slots_, type, true);
+        if (!found) return false;  // Table full: cannot enforce the default, so reject
+    }
+    QuotaSlot &slot = *found;
+    SlotLock lock(slot);
+    QuotaLimit limit = effective_limit(addr_, slot);
+    int64_t len = static_cast<int64_t>(bytes);
+
+    if (limit.cap_bytes && slot.inflight_bytes + len > static_cast<int64_t>(limit.cap_bytes)) {
+        if (count_rejection) ++slot.rejected;
+        return false;
+    }
+    if (limit.rate_bytes_per_s) {
+        uint64_t now = monotonicNs();
+        double burst = static_cast<double>(limit.burst_bytes);
+        if (slot.last_refill_ns == 0) {
+            slot.tokens = burst;
+        } else {
+            double refill = limit.rate_bytes_per_s * ((now - slot.last_refill_ns) / 1e9);
+            slot.tokens = std::min(burst, slot.tokens + refill);
+        }
+        slot.last_refill_ns = now;
+        // A message larger than the burst could never collect enough tokens: admit it once
+        // the bucket is full, and let the bucket go into debt that the refill pays off first
+        if (slot.tokens < len && slot.tokens < burst) {
+            if (count_rejection) ++slot.rejected;
+            return false;
+        }
+        slot.tokens -= len;
+    }
+
+    slot.inflight_bytes += len;
+    ++slot.sent;
+    return true;
+}
+
+void TypeQuota::countRejection(long type) {
+    QuotaSlot *slot = find_slot(addr_, num_slots_, type, false);
+    if (!slot) return;
+    SlotLock lock(*slot);
+    ++slot->rejected;
+}
+
+void TypeQuota::cancel(long type, size_t bytes) {
+    QuotaSlot *slot = find_slot(addr_, num_slots_, type, false);
+    if (!slot) return;
+    SlotLock lock(*slot);
+    int64_t len = static_cast<int64_t>(bytes);
+    slot->inflight_bytes = std::max<int64_t>(0, slot->inflight_bytes - len);
+    if (slot->sent) --slot->sent;
+    QuotaLimit limit = effective_limit(addr_, *slot);
+    if (limit.rate_bytes_per_s) {
+        slot->tokens = std::min(static_cast<double>(limit.burst_bytes), slot->tokens + len);
+    }
+}
+
+void TypeQuota::release(long type, size_t bytes) {
+    QuotaSlot *slot = find_slot(addr_, num_slots_, type, false);
+    if (!slot) return;
+    SlotLock lock(*slot);
+    // Clamp at zero: messages sent without quota accounting may be received through it
+    slot->inflight_bytes = std::max<int64_t>(0, slot->inflight_bytes - static_cast<int64_t>(bytes));
+}
+
+void TypeQuota::resetInflight(long type) {
+    QuotaSlot *slot = find_slot(addr_, num_slots_, type, false);
+    if (!slot) return;
+    SlotLock lock(*slot);
+    slot->inflight_bytes = 0;
+}
+
+void TypeQuota::resetInflight() {
+    uint64_t n = num_slots_;
+    QuotaSlot *slots = slots_of(addr_);
+    for (uint64_t i = 0; i < n; ++i) {
+        if (slots[i].type.load(std::memory_order_acquire) == 0) continue;
+        SlotLock lock(slots[i]);
+        slots[i].inflight_bytes = 0;
+    }
+}
+
+std::vector<QuotaUsage> TypeQuota::getUsage() const {
+    std::vector<QuotaUsage> usage;
+    uint64_t n = num_slots_;
+    QuotaSlot *slots = slots_of(addr_);
+    for (uint64_t i = 0; i < n; ++i) {
+        QuotaSlot &slot = slots[i];
+        long type = slot.type.load(std::memory_order_acquire);
+        if (type == 0) continue;
+
+        SlotLock lock(slot);
+        QuotaUsage u;
+        u.type = type;
+        u.configured = slot.configured != 0;
+        u.limit = effective_limit(addr_, slot);
+        u.inflight_bytes = slot.inflight_bytes;
+        u.sent = slot.sent;
+        u.rejected = slot.rejected;
+        usage.push_back(u);
+    }
+    std::sort(usage.begin(), usage.end(), [](const QuotaUsage& a, const QuotaUsage& b) { return a.type < b.type; });
+    return usage;
+}
+
+void TypeQuota::remove() {
+    removeSegment(shmid_, "quota table");
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <stdexcept>
+#include <sys/types.h>
+
+// Per-type send limits. A zero field means "unlimited".
+struct QuotaLimit {
+    uint64_t cap_bytes = 0;           // Maximum bytes of this type in flight (sent, not yet received)
+    uint64_t rate_bytes_per_s = 0;    // Token-bucket refill rate
+    uint64_t burst_bytes = 0;         // Token-bucket size (0 = one second worth of rate); a larger
+                                      // message is admitted when the bucket is full
+};
+
+// Snapshot of one message type's quota accounting
+struct QuotaUsage {
+    long type;                 // Message type
+    bool configured;           // true if the type has its own limit, false if it uses the default
+    QuotaLimit limit;          // Effective limit
+    int64_t inflight_bytes;    // Bytes sent but not yet received
+    uint64_t sent;             // Messages admitted
+    uint64_t rejected;         // Messages rejected as over quota
+};
+
+// Fair-share quota table for the message types of a queue, stored in a System V shared
+// memory segment so that all producers and consumers see the same counters.
+//
+// Producers call tryAcquire before sending and consumers call release after receiving, so
+// each type's in-flight bytes track its share of msg_qbytes. A type over its byte cap or
+// out of token-bucket budget is rejected, leaving queue space for the other types.
+// Types without their own limit use the table-wide default limit.
+class TypeQuota {
+public:
+    // Create the shared quota table for key, or attach to it if it already exists.
+    // max_types bounds how many distinct message types can be tracked.
+    // Throws std::runtime_error on failure
+    static TypeQuota open(key_t key, size_t max_types = 256, unsigned short permissions = 0600);
+
+    // Attach to an existing shared quota table
+    // Throws std::runtime_error on failure
+    static TypeQuota attach(key_t key);
+
+    // Set the limit for one message type
+    // Throws std::invalid_argument on a non-positive type, std::runtime_error if the table is full
+    void setLimit(long type, const QuotaLimit &limit);
+
+    // Set the limit used by types without a limit of their own
+    void setDefaultLimit(const QuotaLimit &limit);
+
+    // Get the limit used by types without a limit of their own
+    QuotaLimit getDefaultLimit() const;
+
+    // Admit bytes of the given type if it is within its cap and rate; counts them as in flight.
+    // Returns false if over quota, counting a rejection unless count_rejection is false
+    // (callers that retry count once with countRejection instead). Never blocks.
+    // Types without a limit of their own are admitted untracked while the default limit is
+    // unlimited; under a default limit they are rejected once the table is full.
+    // Throws std::invalid_argument on a non-positive type
+    bool tryAcquire(long type, size_t bytes, bool count_rejection = true);
+
+    // Count one rejected message for the given type (ignored if the type is not tracked)
+    // Throws std::invalid_argument on a non-positive type
+    void countRejection(long type);
+
+    // Undo a successful tryAcquire whose message was never sent (also refunds rate tokens)
+    void cancel(long type, size_t bytes);
+
+    // Account for bytes of the given type leaving the queue (called on receive)
+    void release(long type, size_t bytes);
+
+    // Reset the in-flight bytes of one type to zero. Use this to recover when messages left the
+    // queue without release (received without the quota table, or the queue was removed).
+    // Throws std::invalid_argument on a non-positive type
+    void resetInflight(long type);
+
+    // Reset the in-flight bytes of every type to zero
+    void resetInflight();
+
+    // Get accounting for every tracked type
+    std::vector<QuotaUsage> getUsage() const;
+
+    // Remove (delete) the shared memory segment.
+    // Throws std::runtime_error on failure
+    void remove();
+
+    // Get underlying shmid
+    int getShmid() const { return shmid_; }
+
+    // Destructor: detaches from the shared memory segment
+    ~TypeQuota();
+
+    // Deleted copy operations
+    TypeQuota(const TypeQuota&) = delete;
+    TypeQuota& operator=(const TypeQuota&) = delete;
+
+    // Allowed move operations
+    TypeQuota(TypeQuota&& other) noexcept;
+    TypeQuota& operator=(TypeQuota&& other) noexcept;
+
+private:
+    TypeQuota(int shmid, void *addr, uint64_t num_slots);
+
+    int shmid_;
+    void *addr_;
+    uint64_t num_slots_;   // Validated slot count, never re-read from the shared header
+};
@@ -0,0 +1,157 @@
+#include "message_quota.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+
+bool parse_key_t(const std::string& s, key_t& key) {
+    try {
+        size_t idx;
+        long k = std::stol(s, &idx, 0);
+        if (idx != s.size() || k <= 0) return false;
+        key = static_cast<key_t>(k);
+        return true;
+    } catch (...) {
+        return false;
+    }
+}
+
+bool parse_long(const std::string& s, long& value) {
+    try {
+        size_t idx;
+        long v = std::stol(s, &idx, 0);
+        if (idx != s.size() || v <= 0) return false;
+        value = v;
+        return true;
+    } catch (...) {
+        return false;
+    }
+}
+
+bool parse_uint64(const std::string& s, uint64_t& value) {
+    try {
+        size_t idx;
+        value = std::stoull(s, &idx, 0);
+        return idx == s.size() && s[0] != '-';
+    } catch (...) {
+        return false;
+    }
+}
+
+std::string format_limit(uint64_t value) {
+    return value ? std::to_string(value) : "-";
+}
+
+void print_usage() {
+    std::cout << "Usage: message_quotactl <key> show\n"
+              << "       message_quotactl <key> set <type|default> <cap_bytes> [rate_bytes_per_s [burst_bytes]]\n"
+              << "       message_quotactl <key> reset [type]\n"
+              << "       message_quotactl <key> rm\n"
+              << "  <key>             : System V key of the shared quota table (created on first use)\n"
+              << "  show              : list limits, in-flight bytes and rejections per message type\n"
+              << "  set               : set the limit for one type, or the default for all other types\n"
+              << "  <cap_bytes>       : maximum in-flight bytes (0 = unlimited)\n"
+              << "  <rate_bytes_per_s>: optional; token-bucket rate (0 = unlimited)\n"
+              << "  <burst_bytes>     : optional; token-bucket size (default: one second of rate)\n"
+              << "  reset             : zero the in-flight bytes of one type, or of all types; use it when\n"
+              << "                      messages left the queue without releasing their quota\n"
+              << "  rm                : remove the shared quota table\n";
+}
+
+int show(TypeQuota& quota) {
+    QuotaLimit def = quota.getDefaultLimit();
+    std::cout << "Default limit: cap " << format_limit(def.cap_bytes)
+              << ", rate " << format_limit(def.rate_bytes_per_s)
+              << ", burst " << format_limit(def.burst_bytes) << "\n";
+
+    std::cout << std::left << std::setw(10) << "type" << std::setw(8) << "own" << std::setw(12) << "cap"
+              << std::setw(12) << "rate" << std::setw(12) << "burst" << std::setw(12) << "inflight"
+              << std::setw(12) << "sent" << "rejected\n";
+    for (const QuotaUsage& u : quota.getUsage()) {
+        std::cout << std::setw(10) << u.type << std::setw(8) << (u.configured ? "yes" : "no")
+                  << std::setw(12) << format_limit(u.limit.cap_bytes)
+                  << std::setw(12) << format_limit(u.limit.rate_bytes_per_s)
+                  << std::setw(12) << format_limit(u.limit.burst_bytes)
+                  << std::setw(12) << u.inflight_bytes << std::setw(12) << u.sent << u.rejected << "\n";
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    key_t key = 0;
+    if (argc < 3 || !parse_key_t(argv[1], key)) {
+        if (argc >= 2) std::cerr << "Error: Invalid arguments.\n";
+        print_usage();
+        return argc >= 2 ? 1 : 0;
+    }
+    std::string command = argv[2];
+
+    try {
+        if (command == "rm") {
+            TypeQuota::attach(key).remove();
+            std::cout << "Quota table removed successfully!\n";
+            std::cout << "  key : " << key << "\n";
+            return 0;
+        }
+
+        if (command == "show") {
+            TypeQuota quota = TypeQuota::attach(key);
+            return show(quota);
+        }
+
+        if (command == "reset" && argc <= 4) {
+            long type = 0;
+            if (argc == 4 && !parse_long(argv[3], type)) {
+                std::cerr << "Error: Invalid type value.\n";
+                print_usage();
+                return 1;
+            }
+            TypeQuota quota = TypeQuota::attach(key);
+            if (type != 0) quota.resetInflight(type);
+            else quota.resetInflight();
+
+            std::cout << "Quota in-flight bytes reset successfully!\n";
+            std::cout << "  key   : " << key << "\n";
+            std::cout << "  type  : " << (type != 0 ? std::to_string(type) : "all") << "\n";
+            return 0;
+        }
+
+        if (command == "set" && argc >= 5) {
+            long type = 0;
+            std::string target = argv[3];
+            if (target != "default" && !parse_long(target, type)) {
+                std::cerr << "Error: Invalid type value.\n";
+                print_usage();
+                return 1;
+            }
+            QuotaLimit limit;
+            if (!parse_uint64(argv[4], limit.cap_bytes)
+                || (argc >= 6 && !parse_uint64(argv[5], limit.rate_bytes_per_s))
+                || (argc >= 7 && !parse_uint64(argv[6], limit.burst_bytes))) {
+                std::cerr << "Error: Invalid limit value.\n";
+                print_usage();
+                return 1;
+            }
+
+            TypeQuota quota = TypeQuota::open(key);
+            if (target == "default") quota.setDefaultLimit(limit);
+            else quota.setLimit(type, limit);
+
+            std::cout << "Quota limit set successfully!\n";
+            std::cout << "  key   : " << key << "\n";
+            std::cout << "  type  : " << target << "\n";
+            std::cout << "  cap   : " << format_limit(limit.cap_bytes) << "\n";
+            std::cout << "  rate  : " << format_limit(limit.rate_bytes_per_s) << "\n";
+            std::cout << "  burst : " << format_limit(limit.burst_bytes) << "\n";
+            return 0;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Quota operation failed: " << e.what() << "\n";
+        return 1;
+    }
+
+    std::cerr << "Error: Unknown command '" << command << "'.\n";
+    print_usage();
+    return 1;
+}
@@ -0,0 +1,148 @@
+#include "message_queue.hpp"
+#include "message_reaper.hpp"
+#include "message_quota.hpp"
+#include "sharded_queue.hpp"
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <csignal>
+#include <pthread.h>
+
+bool parse_int(const std::string& s, int& value) {
+    try {
+        size_t idx;
+        long v = std::stol(s, &idx, 0);
+        if (idx != s.size() || v < 0) return false;
+        value = static_cast<int>(v);
+        return true;
+    } catch (...) {
+        return false;
+    }
+}
+
+bool parse_key_t(const std::string& s, key_t& key) {
+    try {
+        size_t idx;
+        long k = std::stol(s, &idx, 0);
+        if (idx != s.size() || k <= 0) return false;
+        key = static_cast<key_t>(k);
+        return true;
+    } catch (...) {
+        return false;
+    }
+}
+
+void print_usage() {
+    std::cout << "Usage: message_reap <msqid> [msqid ...] [--interval <ms>] [--quota <key>]\n"
+              << "  <msqid>          : message queue ID(s) to remove expired TTL messages from;\n"
+              << "                     shard:<base_key>:<count> reaps every shard\n"
+              << "  [--interval <ms>]: optional; keep reaping every <ms> milliseconds until SIGINT/SIGTERM\n"
+              << "  [--quota <key>]  : optional; release reaped bytes from the per-type quota table <key>\n"
+              << "  Without --interval, a single pass is made over each queue.\n";
+}
+
+// Collect the msqid, or every shard's msqid of a sharded channel spec
+bool add_target(const std::string& s, std::vector<int>& msqids) {
+    if (ShardedQueue::isSpec(s)) {
+        try {
+            ShardedQueue channel = ShardedQueue::attach(s);
+            msqids.insert(msqids.end(), channel.getMsqids().begin(), channel.getMsqids().end());
+            return true;
+        } catch (const std::exception& e) {
+            std::cerr << "Failed to attach to sharded channel " << s << ": " << e.what() << "\n";
+            return false;
+        }
+    }
+    int msqid = -1;
+    if (!parse_int(s, msqid)) return false;
+    msqids.push_back(msqid);
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<int> msqids;
+    int interval_ms = 0;
+    key_t quota_key = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--interval" && i + 1 < argc) {
+            if (!parse_int(argv[++i], interval_ms) || interval_ms == 0) {
+                std::cerr << "Error: Invalid interval value.\n";
+                print_usage();
+                return 1;
+            }
+            continue;
+        }
+        if (arg == "--quota" && i + 1 < argc) {
+            if (!parse_key_t(argv[++i], quota_key)) {
+                std::cerr << "Error: Invalid quota key value.\n";
+                print_usage();
+                return 1;
+            }
+            continue;
+        }
+        if (!add_target(arg, msqids)) {
+            std::cerr << "Error: Invalid msqid value '" << arg << "'.\n";
+            print_usage();
+            return 1;
+        }
+    }
+    if (msqids.empty()) {
+        print_usage();
+        return 1;
+    }
+
+    std::unique_ptr<TypeQuota> quota;
+    if (quota_key != 0) {
+        try {
+            quota.reset(new TypeQuota(TypeQuota::attach(quota_key)));
+        } catch (const std::exception& e) {
+            std::cerr << "Failed to attach to quota table: " << e.what() << "\n";
+            return 1;
+        }
+    }
+
+    if (interval_ms == 0) {
+        bool any_failed = false;
+        for (int msqid : msqids) {
+            try {
+                uint64_t bytes_before = MessageQueue::getExpiryStats(msqid).expired_bytes;
+                size_t reaped = MessageQueue::reapExpired(msqid, quota.get());
+                std::cout << "Expired messages reaped successfully!\n";
+                std::cout << "  msqid   : " << msqid << "\n";
+                std::cout << "  removed : " << reaped << " ("
+                          << MessageQueue::getExpiryStats(msqid).expired_bytes - bytes_before << " bytes)\n";
+            } catch (const std::exception& e) {
+                std::cerr << "Failed to reap message queue " << msqid << ": " << e.what() << "\n";
+                any_failed = true;
+            }
+        }
+        return any_failed ? 1 : 0;
+    }
+
+    // Daemon mode: block the stop signals here (inherited by the reaper thread) and wait for them
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    ExpiryReaper reaper(msqids, static_cast<unsigned int>(interval_ms), quota.get());
+    std::cout << "Reaping " << msqids.size() << " queue(s) every " << interval_ms << " ms (Ctrl+C to stop)\n";
+
+    int sig = 0;
+    sigwait(&signals, &sig);
+    reaper.stop();
+
+    std::cout << "Reaper stopped.\n";
+    std::cout << "  removed : " << reaper.getReapedCount() << "\n";
+    std::string error = reaper.getLastError();
+    if (!error.empty()) {
+        std::cerr << "Last error: " << error << "\n";
+        return 1;
+    }
+    return 0;
+}
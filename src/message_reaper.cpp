@@ -0,0 +1,67 @@
+#include "message_reaper.hpp"
+#include "message_queue.hpp"
+
+#include <chrono>
+#include <stdexcept>
+#include <algorithm>
+
+ExpiryReaper::ExpiryReaper(const std::vector<int> &msqids, unsigned int interval_ms, TypeQuota *quota)
+    : msqids_(msqids), interval_ms_(interval_ms), quota_(quota)
+{
+    if (msqids_.empty()) throw std::invalid_argument("Reaper needs at least one queue");
+    if (interval_ms_ == 0) throw std::invalid_argument("Reaper interval must be positive");
+    thread_ = std::thread(&ExpiryReaper::run, this);
+}
+
+ExpiryReaper::~ExpiryReaper() {
+    stop();
+}
+
+void ExpiryReaper::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    if (thread_.joinable()) thread_.join();
+}
+
+uint64_t ExpiryReaper::getReapedCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return reaped_;
+}
+
+std::string ExpiryReaper::getLastError() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return last_error_;
+}
+
+void ExpiryReaper::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopping_ && !msqids_.empty()) {
+        std::vector<int> msqids = msqids_;
+        lock.unlock();
+
+        uint64_t reaped = 0;
+        std::vector<int> failed;
+        std::string error;
+        for (int msqid : msqids) {
+            try {
+                reaped += MessageQueue::reapExpired(msqid, quota_);
+            } catch (const std::exception& e) {
+                failed.push_back(msqid);
+                error = "msqid " + std::to_string(msqid) + ": " + e.what();
+            }
+        }
+
+        lock.lock();
+        reaped_ += reaped;
+        if (!failed.empty()) {
+            last_error_ = error;
+            for (int msqid : failed) {
+                msqids_.erase(std::remove(msqids_.begin(), msqids_.end(), msqid), msqids_.end());
+            }
+        }
+        cv_.wait_for(lock, std::chrono::milliseconds(interval_ms_), [this] { return stopping_; });
+    }
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+
+class TypeQuota;
+
+// Background thread that periodically removes expired TTL messages from a set of queues
+// (MessageQueue::reapExpired), so that idle queues with no consumer do not keep expired
+// bytes counted against msg_qbytes. Stops and joins on destruction.
+class ExpiryReaper {
+public:
+    // Start reaping the given queues every interval_ms milliseconds. If quota is given (it must
+    // outlive the reaper), the bytes of reaped messages are released from it.
+    // Throws std::invalid_argument on an empty queue list or zero interval
+    ExpiryReaper(const std::vector<int> &msqids, unsigned int interval_ms, TypeQuota *quota = nullptr);
+
+    // Stop the reaper thread (idempotent)
+    void stop();
+
+    // Total expired messages removed so far
+    uint64_t getReapedCount() const;
+
+    // Last error seen by the reaper thread, empty if none.
+    // Queues that fail (e.g. were removed) are dropped from the reaping set.
+    std::string getLastError() const;
+
+    // Destructor: stops the reaper thread
+    ~ExpiryReaper();
+
+    // Deleted copy and move operations (the thread refers to this object)
+    ExpiryReaper(const ExpiryReaper&) = delete;
+    ExpiryReaper& operator=(const ExpiryReaper&) = delete;
+
+private:
+    void run();
+
+    std::vector<int> msqids_;
+    unsigned int interval_ms_;
+    TypeQuota *quota_;
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stopping_ = false;
+    uint64_t reaped_ = 0;
+    std::string last_error_;
+    std::thread thread_;
+};
@@ -1,9 +1,26 @@
 #include "message_queue.hpp"
+#include "cpu_affinity.hpp"
+#include "message_dedup.hpp"
+#include "message_quota.hpp"
+#include "sharded_queue.hpp"
 
 #include <iostream>
 #include <string>
 #include <limits>
 #include <cstdlib>
+#include <vector>
+#include <memory>
+
+// Expired-message counters summed over the given queues
+ExpiryStats expired_total(const std::vector<int>& msqids) {
+    ExpiryStats total = {};
+    for (int id : msqids) {
+        ExpiryStats stats = MessageQueue::getExpiryStats(id);
+        total.expired_messages += stats.expired_messages;
+        total.expired_bytes += stats.expired_bytes;
+    }
+    return total;
+}
 
 bool parse_int(const std::string& s, int& value) {
     try {
@@ -29,21 +46,67 @@ bool parse_long(const std::string& s, long& value) {
     }
 }
 
+bool parse_spin(const std::string& s, unsigned int& value) {
+    try {
+        size_t idx;
+        unsigned long v = std::stoul(s, &idx, 0);
+        if (idx != s.size() || v > 10000000) return false;
+        value = static_cast<unsigned int>(v);
+        return true;
+    } catch (...) {
+        return false;
+    }
+}
+
+bool parse_key_t(const std::string& s, key_t& key) {
+    try {
+        size_t idx;
+        long k = std::stol(s, &idx, 0);
+        if (idx != s.size() || k <= 0) return false;
+        key = static_cast<key_t>(k);
+        return true;
+    } catch (...) {
+        return false;
+    }
+}
+
 void print_usage() {
-    std::cout << "Usage: message_receive <msqid> <type> [--nowait|-n]\n"
-              << "  <msqid>: message queue ID\n"
+    std::cout << "Usage: message_receive <msqid> <type> [--nowait|-n] [--spin <us>] [--cpus <list>|--numa <node>] [--framed]\n"
+              << "                       [--dedup <key> [--dedup-capacity <n>] [--dedup-window <ms>] | --quota <key>]\n"
+              << "  <msqid>: message queue ID, or a sharded channel as shard:<base_key>:<count>\n"
+              << "           (reads the current CPU's shard first, then steals from the others)\n"
               << "  <type> : message type (positive integer)\n"
-              << "  [--nowait|-n] : optional; do not block if no message is present\n";
+              << "  [--nowait|-n] : optional; do not block if no message is present\n"
+              << "  [--spin <us>] : optional; busy-poll for up to <us> microseconds before blocking\n"
+              << "  [--cpus <list>]: optional; pin to CPUs, e.g. 2 or 0-3,8\n"
+              << "  [--numa <node>]: optional; pin to all CPUs of a NUMA node\n"
+              << "  [--framed]     : optional; the queue carries framed messages (sent with --id or --ttl):\n"
+              << "                   strip the frame header and skip expired messages\n"
+              << "  [--dedup <key>]: optional; drop messages whose id was already seen by the shared filter <key>\n"
+              << "                   (implies --framed)\n"
+              << "  [--dedup-capacity <n>]: optional; ids remembered when creating the filter (default: 65536)\n"
+              << "  [--dedup-window <ms>] : optional; how long ids are remembered (default: 60000)\n"
+              << "  [--quota <key>]: optional; release the message's bytes from the per-type quota table <key>\n";
 }
 
 int main(int argc, char* argv[]) {
     int msqid = -1;
     long type = 0;
     bool nowait = false;
+    bool framed = false;
+    unsigned int spin_us = 0;
+    std::vector<int> cpus;
+    key_t dedup_key = 0;
+    key_t quota_key = 0;
+    size_t dedup_capacity = 65536;
+    unsigned int dedup_window_ms = 60000;
+    std::string spec;
 
     if (argc >= 3) {
-        // -- msqid
-        if (!parse_int(argv[1], msqid)) {
+        // -- msqid or sharded channel spec
+        if (ShardedQueue::isSpec(argv[1])) {
+            spec = argv[1];
+        } else if (!parse_int(argv[1], msqid)) {
             std::cerr << "Error: Invalid msqid value.\n";
             print_usage();
             return 1;
@@ -54,16 +117,76 @@ int main(int argc, char* argv[]) {
             print_usage();
             return 1;
         }
-        // -- nowait flag (optional)
-        if (argc >= 4) {
-            if (std::string(argv[3]) == "--nowait" || std::string(argv[3]) == "-n")
+        // -- optional flags
+        for (int i = 3; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--nowait" || arg == "-n") {
                 nowait = true;
+            } else if (arg == "--framed") {
+                framed = true;
+            } else if (arg == "--spin" && i + 1 < argc) {
+                if (!parse_spin(argv[++i], spin_us)) {
+                    std::cerr << "Error: Invalid spin value.\n";
+                    print_usage();
+                    return 1;
+                }
+            } else if ((arg == "--dedup" || arg == "--quota") && i + 1 < argc) {
+                if (!parse_key_t(argv[++i], arg == "--dedup" ? dedup_key : quota_key)) {
+                    std::cerr << "Error: Invalid " << arg.substr(2) << " key value.\n";
+                    print_usage();
+                    return 1;
+                }
+            } else if ((arg == "--dedup-capacity" || arg == "--dedup-window") && i + 1 < argc) {
+                unsigned int v = 0;
+                if (!parse_spin(argv[++i], v) || (arg == "--dedup-capacity" && v == 0)) {
+                    std::cerr << "Error: Invalid " << arg.substr(2) << " value.\n";
+                    print_usage();
+                    return 1;
+                }
+                if (arg == "--dedup-capacity") dedup_capacity = v;
+                else dedup_window_ms = v;
+            } else if ((arg == "--cpus" || arg == "--numa") && i + 1 < argc) {
+                try {
+                    if (arg == "--cpus") {
+                        cpus = parseCpuList(argv[++i]);
+                    } else {
+                        int node = -1;
+                        if (!parse_int(argv[++i], node)) throw std::invalid_argument("Invalid NUMA node");
+                        cpus = getNumaNodeCpus(node);
+                    }
+                } catch (const std::exception& e) {
+                    std::cerr << "Error: " << e.what() << "\n";
+                    print_usage();
+                    return 1;
+                }
+            } else {
+                std::cerr << "Error: Unknown option '" << arg << "'.\n";
+                print_usage();
+                return 1;
+            }
+        }
+        if (dedup_key != 0 && quota_key != 0) {
+            std::cerr << "Error: --dedup and --quota cannot be combined.\n";
+            print_usage();
+            return 1;
+        }
+        if (!spec.empty() && (spin_us > 0 || framed || dedup_key != 0 || quota_key != 0)) {
+            std::cerr << "Error: --spin, --framed, --dedup and --quota are not supported on a sharded channel.\n";
+            print_usage();
+            return 1;
+        }
+        if (spin_us > 0 && (framed || dedup_key != 0)) {
+            std::cerr << "Error: --spin cannot be combined with --framed or --dedup.\n";
+            print_usage();
+            return 1;
         }
     } else {
         std::cout << "Enter message queue ID (msqid): ";
         std::string msqid_str;
         std::getline(std::cin, msqid_str);
-        if (!parse_int(msqid_str, msqid)) {
+        if (ShardedQueue::isSpec(msqid_str)) {
+            spec = msqid_str;
+        } else if (!parse_int(msqid_str, msqid)) {
             std::cerr << "Error: Invalid msqid value.\n";
             return 1;
         }
@@ -83,13 +206,51 @@ int main(int argc, char* argv[]) {
     }
 
     try {
-        std::string received = MessageQueue::receiveMessage(msqid, type, nowait);
+        if (!cpus.empty()) pinCurrentThread(cpus);
+
+        std::string received;
+        std::vector<int> msqids{msqid};
+        std::unique_ptr<ShardedQueue> channel;
+        if (!spec.empty()) {
+            channel.reset(new ShardedQueue(ShardedQueue::attach(spec)));
+            msqids = channel->getMsqids();
+        }
+        ExpiryStats before = expired_total(msqids);
+
+        if (channel) {
+            received = channel->receiveMessage(type, nowait);
+        } else if (dedup_key != 0) {
+            DedupFilter filter = DedupFilter::open(dedup_key, dedup_capacity, dedup_window_ms);
+            received = MessageQueue::receiveMessageDedup(msqid, type, filter, nowait);
+
+            DedupStats stats = filter.getStats();
+            std::cout << "Dedup filter (key " << dedup_key << "): " << stats.duplicates << " of "
+                      << stats.checked << " ids were duplicates (hit rate "
+                      << stats.hit_rate * 100.0 << "%)\n";
+        } else if (quota_key != 0) {
+            TypeQuota quota = TypeQuota::open(quota_key);
+            received = MessageQueue::receiveMessageQuota(msqid, type, quota, nowait, framed);
+        } else if (framed) {
+            received = MessageQueue::receiveMessageFramed(msqid, type, nowait);
+        } else if (spin_us > 0 && !nowait) {
+            received = MessageQueue::receiveMessageSpin(msqid, type, spin_us);
+        } else {
+            received = MessageQueue::receiveMessage(msqid, type, nowait);
+        }
 
         std::cout << "Message received successfully!\n";
-        std::cout << "  msqid          : " << msqid << "\n";
+        if (spec.empty())
+            std::cout << "  msqid          : " << msqid << "\n";
+        else
+            std::cout << "  channel        : " << spec << "\n";
         std::cout << "  type           : " << type << "\n";
         std::cout << "  bytes received : " << received.size() << "\n";
         std::cout << "  message        : " << received << "\n";
+        // The counters are shared by all processes; report only what this receive discarded
+        ExpiryStats after = expired_total(msqids);
+        if (after.expired_messages > before.expired_messages)
+            std::cout << "  expired skipped: " << after.expired_messages - before.expired_messages << " ("
+                      << after.expired_bytes - before.expired_bytes << " bytes)\n";
     } catch (const std::exception& e) {
         std::cerr << "Failed to receive message: " << e.what() << "\n";
         return 1;
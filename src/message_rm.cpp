@@ -1,4 +1,5 @@
 #include "message_queue.hpp"
+#include "sharded_queue.hpp"
 
 #include <iostream>
 #include <sstream>
@@ -20,22 +21,38 @@ bool parse_int(const std::string& s, int& value) {
 
 void print_usage() {
     std::cout << "Usage: message_rm <msqid> [msqid ...]\n"
-              << "  <msqid>: message queue ID(s) to remove\n"
+              << "  <msqid>: message queue ID(s) to remove; shard:<base_key>:<count> removes every shard and the doorbell\n"
               << "  You can specify multiple IDs separated by spaces.\n";
 }
 
+// Collect the msqid, or the sharded channel of a spec
+bool add_target(const std::string& s, std::vector<int>& msqids, std::vector<ShardedQueue>& channels) {
+    if (ShardedQueue::isSpec(s)) {
+        try {
+            channels.push_back(ShardedQueue::attach(s));
+            return true;
+        } catch (const std::exception& e) {
+            std::cerr << "Failed to attach to sharded channel " << s << ": " << e.what() << "\n";
+            return false;
+        }
+    }
+    int msqid = -1;
+    if (!parse_int(s, msqid)) return false;
+    msqids.push_back(msqid);
+    return true;
+}
+
 int main(int argc, char* argv[]) {
     std::vector<int> msqids;
+    std::vector<ShardedQueue> channels;
 
     if (argc >= 2) {
         for (int i = 1; i < argc; ++i) {
-            int msqid = -1;
-            if (!parse_int(argv[i], msqid)) {
+            if (!add_target(argv[i], msqids, channels)) {
                 std::cerr << "Error: Invalid msqid value '" << argv[i] << "'.\n";
                 print_usage();
                 return 1;
             }
-            msqids.push_back(msqid);
         }
     } else {
         std::cout << "Enter message queue ID(s) to remove (separated by spaces): ";
@@ -44,14 +61,12 @@ int main(int argc, char* argv[]) {
         std::istringstream iss(line);
         std::string token;
         while (iss >> token) {
-            int msqid = -1;
-            if (!parse_int(token, msqid)) {
+            if (!add_target(token, msqids, channels)) {
                 std::cerr << "Error: Invalid msqid value '" << token << "'.\n";
                 return 1;
             }
-            msqids.push_back(msqid);
         }
-        if (msqids.empty()) {
+        if (msqids.empty() && channels.empty()) {
             std::cerr << "No valid msqid provided.\n";
             return 1;
         }
@@ -69,5 +84,19 @@ int main(int argc, char* argv[]) {
         }
     }
 
+    // Removing a channel as a whole also removes its doorbell and wakes its blocked receivers
+    for (ShardedQueue& channel : channels) {
+        try {
+            channel.remove();
+            std::cout << "Sharded channel removed successfully!\n";
+            for (size_t i = 0; i < channel.getNumShards(); ++i) {
+                std::cout << "  shard " << i << " msqid : " << channel.getMsqids()[i] << "\n";
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "Failed to remove sharded channel: " << e.what() << "\n";
+            any_failed = true;
+        }
+    }
+
     return any_failed ? 1 : 0;
 }
\ No newline at end of file
@@ -1,9 +1,12 @@
 #include "message_queue.hpp"
+#include "message_quota.hpp"
+#include "sharded_queue.hpp"
 
 #include <iostream>
 #include <string>
 #include <limits>
 #include <cstdlib>
+#include <memory>
 
 bool parse_int(const std::string& s, int& value) {
     try {
@@ -29,22 +32,62 @@ bool parse_long(const std::string& s, long& value) {
     }
 }
 
+bool parse_message_id(const std::string& s, uint64_t& value) {
+    try {
+        size_t idx;
+        unsigned long long v = std::stoull(s, &idx, 0);
+        if (idx != s.size() || v == 0) return false;
+        value = v;
+        return true;
+    } catch (...) {
+        return false;
+    }
+}
+
+bool parse_key_t(const std::string& s, key_t& key) {
+    try {
+        size_t idx;
+        long k = std::stol(s, &idx, 0);
+        if (idx != s.size() || k <= 0) return false;
+        key = static_cast<key_t>(k);
+        return true;
+    } catch (...) {
+        return false;
+    }
+}
+
 // Print usage
 void print_usage() {
-    std::cout << "Usage: message_send <msqid> <type> [message]\n"
-              << "  <msqid>  : message queue ID\n"
+    std::cout << "Usage: message_send <msqid> <type> [message] [--id <id>] [--ttl <ms>] [--quota <key> [--wait <ms>]]\n"
+              << "                    [--route <key>]\n"
+              << "  <msqid>  : message queue ID, or a sharded channel as shard:<base_key>:<count>\n"
               << "  <type>   : message type (positive integer)\n"
-              << "  [message]: optional; message content (if omitted, will prompt)\n";
+              << "  [message]: optional; message content (if omitted, will prompt)\n"
+              << "  [--id <id>]: optional; non-zero 64-bit message id for deduplicating receivers\n"
+              << "  [--quota <key>]: optional; enforce the per-type quota table with System V key <key>\n"
+              << "  [--wait <ms>]  : optional; with --quota, wait up to <ms> for quota or queue space\n"
+              << "  [--ttl <ms>]   : optional; message expires <ms> milliseconds after sending\n"
+              << "  [--route <key>]: optional; sharded channels only, pick the shard by hashing <key>\n"
+              << "                   (messages with the same key stay ordered; default: shard of the current CPU)\n";
 }
 
 int main(int argc, char* argv[]) {
     int msqid = -1;
     long type = 0;
     std::string message;
+    uint64_t message_id = 0;
+    key_t quota_key = 0;
+    unsigned int wait_ms = 0;
+    unsigned int ttl_ms = 0;
+    std::string spec;
+    uint64_t route_key = 0;
+    bool routed = false;
 
     if (argc >= 3) {
-        // -- msqid
-        if (!parse_int(argv[1], msqid)) {
+        // -- msqid or sharded channel spec
+        if (ShardedQueue::isSpec(argv[1])) {
+            spec = argv[1];
+        } else if (!parse_int(argv[1], msqid)) {
             std::cerr << "Error: Invalid msqid value.\n";
             print_usage();
             return 1;
@@ -55,15 +98,61 @@ int main(int argc, char* argv[]) {
             print_usage();
             return 1;
         }
-        // -- message (optional)
-        if (argc >= 4) {
-            message = argv[3];
+        // -- message and --id (optional)
+        for (int i = 3; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--id" && i + 1 < argc) {
+                if (!parse_message_id(argv[++i], message_id)) {
+                    std::cerr << "Error: Invalid message id value.\n";
+                    print_usage();
+                    return 1;
+                }
+            } else if (arg == "--quota" && i + 1 < argc) {
+                if (!parse_key_t(argv[++i], quota_key)) {
+                    std::cerr << "Error: Invalid quota key value.\n";
+                    print_usage();
+                    return 1;
+                }
+            } else if ((arg == "--wait" || arg == "--ttl") && i + 1 < argc) {
+                int v = -1;
+                if (!parse_int(argv[++i], v) || (arg == "--ttl" && v == 0)) {
+                    std::cerr << "Error: Invalid " << arg.substr(2) << " value.\n";
+                    print_usage();
+                    return 1;
+                }
+                (arg == "--wait" ? wait_ms : ttl_ms) = static_cast<unsigned int>(v);
+            } else if (arg == "--route" && i + 1 < argc) {
+                try {
+                    size_t idx;
+                    std::string v = argv[++i];
+                    route_key = std::stoull(v, &idx, 0);
+                    if (idx != v.size() || v[0] == '-') throw std::invalid_argument("route");
+                    routed = true;
+                } catch (...) {
+                    std::cerr << "Error: Invalid route value.\n";
+                    print_usage();
+                    return 1;
+                }
+            } else if (message.empty()) {
+                message = arg;
+            } else {
+                std::cerr << "Error: Unexpected argument '" << arg << "'.\n";
+                print_usage();
+                return 1;
+            }
+        }
+        if (routed && spec.empty()) {
+            std::cerr << "Error: --route requires a sharded channel.\n";
+            print_usage();
+            return 1;
         }
     } else {
         std::cout << "Enter message queue ID (msqid): ";
         std::string msqid_str;
         std::getline(std::cin, msqid_str);
-        if (!parse_int(msqid_str, msqid)) {
+        if (ShardedQueue::isSpec(msqid_str)) {
+            spec = msqid_str;
+        } else if (!parse_int(msqid_str, msqid)) {
             std::cerr << "Error: Invalid msqid value.\n";
             return 1;
         }
@@ -88,19 +177,58 @@ int main(int argc, char* argv[]) {
     }
 
     try {
-         QueueInfo info = MessageQueue::getInfo(msqid);
+        // A sharded channel sends to one shard, which is then used like a plain queue
+        std::unique_ptr<ShardedQueue> channel;
+        size_t shard = 0;
+        if (!spec.empty()) {
+            channel.reset(new ShardedQueue(ShardedQueue::attach(spec)));
+            shard = routed ? channel->shardForKey(route_key) : channel->shardForCpu();
+            msqid = channel->getMsqids()[shard];
+        }
+
+        QueueInfo info = MessageQueue::getInfo(msqid);
         if (message.size() > info.max_bytes) {
             std::cerr << "Error: Message size (" << message.size()
                       << ") exceeds queue max_bytes (" << info.max_bytes << ").\n";
             return 1;
         }
 
-        MessageQueue::sendMessage(msqid, type, message);
+        // --id and --ttl travel in a frame header; without them the message is sent as-is
+        SendOptions options;
+        options.message_id = message_id;
+        options.ttl_ms = ttl_ms;
+        bool framed = message_id != 0 || ttl_ms != 0;
+
+        if (quota_key != 0) {
+            TypeQuota quota = TypeQuota::open(quota_key);
+            SendStatus status = framed ? MessageQueue::trySendMessageQuota(msqid, type, message, quota, wait_ms, options)
+                                       : MessageQueue::trySendMessageQuota(msqid, type, message, quota, wait_ms);
+            if (status == SendStatus::OverQuota) {
+                std::cerr << "Message rejected: type " << type << " is over its quota.\n";
+                return 2;
+            }
+            if (status == SendStatus::QueueFull) {
+                std::cerr << "Message rejected: queue is full.\n";
+                return 2;
+            }
+        } else if (framed) {
+            MessageQueue::sendMessage(msqid, type, message, options);
+        } else {
+            MessageQueue::sendMessage(msqid, type, message);
+        }
+        // The shard was written to directly, so ring the channel's doorbell ourselves
+        if (channel) channel->wakeReceivers();
 
         std::cout << "Message sent successfully!\n";
+        if (channel)
+            std::cout << "  shard      : " << shard << " of " << spec << "\n";
         std::cout << "  msqid      : " << info.msqid << "\n";
         std::cout << "  type       : " << type << "\n";
         std::cout << "  bytes sent : " << message.size() << "\n";
+        if (message_id != 0)
+            std::cout << "  message id : " << message_id << "\n";
+        if (ttl_ms != 0)
+            std::cout << "  ttl        : " << ttl_ms << " ms\n";
     } catch (const std::exception& e) {
         std::cerr << "Failed to send message: " << e.what() << "\n";
         return 1;
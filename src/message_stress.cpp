@@ -0,0 +1,440 @@
+#include "message_queue.hpp"
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <cstring>
+#include <cstdint>
+#include <cstdio>
+#include <cerrno>
+#include <new>
+#include <csignal>
+#include <sys/ipc.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Stress test for concurrent queue operations.
+// Each round creates a private queue and forks worker processes, each running several
+// threads that issue randomized send, receive and setMaxBytes calls. Resizes may shrink
+// msg_qbytes below the payload size, so sends race resizes and queued messages end up larger
+// than the queue limit; receives must still deliver them. The round then:
+//   1. drains the queue and checks that every sent message was received exactly once,
+//   2. parks every worker in a blocking receive and removes the queue underneath them,
+//      checking that all of them wake up with an error instead of hanging.
+// Some rounds, chosen at random, instead remove the queue at a random point of the churn,
+// while sends and receives are in flight; every worker must see an error and exit cleanly.
+// Every payload carries a checksum and a per-(worker, type) sequence number, so corruption,
+// duplication and reordering are detected on receive.
+
+using Clock = std::chrono::steady_clock;
+
+static const uint32_t PAYLOAD_MAGIC = 0x53545253;  // "STRS"
+static const long NUM_TYPES = 4;
+
+enum Phase : uint32_t { PHASE_CHURN, PHASE_DRAIN, PHASE_BLOCK };
+
+struct PayloadHeader {
+    uint32_t magic;
+    uint32_t worker;
+    uint32_t type;
+    uint32_t body_len;
+    uint64_t seq;
+    uint64_t checksum;
+};
+
+// Shared between the coordinator and all worker processes (MAP_SHARED | MAP_ANONYMOUS)
+struct SharedState {
+    std::atomic<uint32_t> phase;
+    std::atomic<uint32_t> drain_acks;
+    std::atomic<uint32_t> blocked;
+    std::atomic<uint64_t> sent;
+    std::atomic<uint64_t> sent_bytes;
+    std::atomic<uint64_t> received;
+    std::atomic<uint64_t> received_bytes;
+    std::atomic<uint64_t> queue_full;
+    std::atomic<uint64_t> resizes;
+    std::atomic<uint64_t> resize_races;
+    std::atomic<uint64_t> oversize_sends;
+    std::atomic<uint32_t> removed;
+    std::atomic<uint64_t> live_removals;
+    std::atomic<uint64_t> failures;
+    std::atomic<uint32_t> error_set;
+    char first_error[256];
+};
+
+struct Config {
+    unsigned int processes = 2;
+    unsigned int threads = 4;
+    unsigned int rounds = 5;
+    unsigned int round_ms = 1000;
+    size_t max_size = 512;
+    bool resize = true;
+    uint64_t seed = 1;
+};
+
+static SharedState *g_state = nullptr;
+
+bool parse_uint64(const std::string& s, uint64_t& value) {
+    try {
+        size_t idx;
+        value = std::stoull(s, &idx, 0);
+        return idx == s.size() && s[0] != '-';
+    } catch (...) {
+        return false;
+    }
+}
+
+void print_usage() {
+    std::cout << "Usage: message_stress [options]\n"
+              << "  --processes <n> : worker processes per round (default: 2)\n"
+              << "  --threads <n>   : threads per worker process (default: 4)\n"
+              << "  --rounds <n>    : create/churn/drain/remove rounds (default: 5)\n"
+              << "  --round-ms <ms> : churn time per round (default: 1000)\n"
+              << "  --max-size <n>  : maximum payload size in bytes (default: 512)\n"
+              << "  --no-resize     : do not call setMaxBytes during churn\n"
+              << "  --seed <n>      : random seed (default: 1)\n"
+              << "  Exits with status 1 if any integrity check fails.\n";
+}
+
+static void fail(const std::string& what) {
+    g_state->failures.fetch_add(1);
+    uint32_t expected = 0;
+    if (g_state->error_set.compare_exchange_strong(expected, 1)) {
+        std::snprintf(g_state->first_error, sizeof(g_state->first_error), "%s", what.c_str());
+    }
+}
+
+// Errors a worker may see once the coordinator removed the queue under live traffic
+static bool queue_removed(const std::string& what) {
+    return g_state->removed.load()
+        && (what.find(strerror(EIDRM)) != std::string::npos || what.find(strerror(EINVAL)) != std::string::npos);
+}
+
+// FNV-1a
+static uint64_t checksum(const char *data, size_t len) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < len; ++i) {
+        h ^= static_cast<unsigned char>(data[i]);
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+static std::string make_payload(uint32_t worker, uint32_t type, uint64_t seq, size_t body_len, std::mt19937_64& rng) {
+    std::string payload(sizeof(PayloadHeader) + body_len, '\0');
+    for (size_t i = sizeof(PayloadHeader); i < payload.size(); ++i) {
+        payload[i] = static_cast<char>(rng());
+    }
+    PayloadHeader hdr;
+    hdr.magic = PAYLOAD_MAGIC;
+    hdr.worker = worker;
+    hdr.type = type;
+    hdr.body_len = static_cast<uint32_t>(body_len);
+    hdr.seq = seq;
+    hdr.checksum = checksum(payload.data() + sizeof(PayloadHeader), body_len);
+    std::memcpy(&payload[0], &hdr, sizeof(hdr));
+    return payload;
+}
+
+// Check a received payload; last_seq tracks the newest sequence seen per (worker, type)
+static void verify_payload(const std::string& msg, long requested_type, std::vector<uint64_t>& last_seq) {
+    PayloadHeader hdr;
+    if (msg.size() < sizeof(hdr)) {
+        fail("short message (" + std::to_string(msg.size()) + " bytes)");
+        return;
+    }
+    std::memcpy(&hdr, msg.data(), sizeof(hdr));
+    if (hdr.magic != PAYLOAD_MAGIC || hdr.body_len != msg.size() - sizeof(hdr)) {
+        fail("corrupt header");
+        return;
+    }
+    if (hdr.checksum != checksum(msg.data() + sizeof(hdr), hdr.body_len)) {
+        fail("checksum mismatch from worker " + std::to_string(hdr.worker) + " seq " + std::to_string(hdr.seq));
+        return;
+    }
+    if (requested_type != 0 && hdr.type != requested_type) {
+        fail("received type " + std::to_string(hdr.type) + " when asking for " + std::to_string(requested_type));
+        return;
+    }
+    size_t slot = static_cast<size_t>(hdr.worker) * NUM_TYPES + (hdr.type - 1);
+    if (slot >= last_seq.size() || hdr.type < 1 || hdr.type > NUM_TYPES) {
+        fail("header out of range");
+        return;
+    }
+    // Each consumer sees a subsequence of the queue's FIFO order, so sequences must increase
+    if (hdr.seq <= last_seq[slot]) {
+        fail("out of order or duplicate: worker " + std::to_string(hdr.worker) + " type " + std::to_string(hdr.type)
+             + " seq " + std::to_string(hdr.seq) + " after " + std::to_string(last_seq[slot]));
+        return;
+    }
+    last_seq[slot] = hdr.seq;
+}
+
+static bool try_receive(int msqid, long type, std::vector<uint64_t>& last_seq) {
+    try {
+        std::string msg = MessageQueue::receiveMessage(msqid, type, true);
+        verify_payload(msg, type, last_seq);
+        g_state->received.fetch_add(1);
+        g_state->received_bytes.fetch_add(msg.size());
+        return true;
+    } catch (const std::runtime_error& e) {
+        std::string what = e.what();
+        if (what.find("No message") == std::string::npos && !queue_removed(what)) fail("receive: " + what);
+        return false;
+    }
+}
+
+static void run_worker_thread(const Config& cfg, int msqid, uint32_t worker, uint32_t total_workers) {
+    std::mt19937_64 rng(cfg.seed * 1000003 + worker);
+    std::vector<uint64_t> next_seq(NUM_TYPES, 1);
+    std::vector<uint64_t> last_seq(static_cast<size_t>(total_workers) * NUM_TYPES, 0);
+    std::uniform_int_distribution<size_t> size_dist(0, cfg.max_size - sizeof(PayloadHeader));
+    std::uniform_int_distribution<long> type_dist(1, NUM_TYPES);
+
+    // Phase 0: randomized churn
+    while (g_state->phase.load() == PHASE_CHURN) {
+        unsigned int op = rng() % 100;
+        if (op < 50) {
+            long type = type_dist(rng);
+            std::string payload = make_payload(worker, type, next_seq[type - 1], size_dist(rng), rng);
+            try {
+                if (MessageQueue::trySendMessage(msqid, type, payload)) {
+                    ++next_seq[type - 1];
+                    g_state->sent.fetch_add(1);
+                    g_state->sent_bytes.fetch_add(payload.size());
+                } else {
+                    g_state->queue_full.fetch_add(1);
+                }
+            } catch (const std::length_error&) {
+                g_state->oversize_sends.fetch_add(1);   // Queue shrunk below the message size
+            } catch (const std::runtime_error& e) {
+                // msgsnd rejects a message larger than msg_qbytes with EINVAL, which can happen
+                // when setMaxBytes shrinks the queue between the size check and the send
+                std::string what = e.what();
+                if (queue_removed(what)) continue;
+                if (cfg.resize && what.find(strerror(EINVAL)) != std::string::npos)
+                    g_state->resize_races.fetch_add(1);
+                else
+                    fail("send: " + what);
+            }
+        } else if (op < 95) {
+            long type = (rng() % 2) ? 0 : type_dist(rng);
+            try_receive(msqid, type, last_seq);
+        } else if (cfg.resize) {
+            // One resize in four shrinks the queue below the largest payload
+            size_t max_bytes = (rng() % 4 == 0) ? 1 + rng() % cfg.max_size
+                                                : cfg.max_size + rng() % (16 * cfg.max_size);
+            try {
+                MessageQueue::setMaxBytes(msqid, max_bytes);
+                g_state->resizes.fetch_add(1);
+            } catch (const std::runtime_error& e) {
+                // Raising msg_qbytes above MSGMNB needs CAP_SYS_RESOURCE
+                std::string what = e.what();
+                if (what.find(strerror(EPERM)) == std::string::npos && !queue_removed(what))
+                    fail("setMaxBytes: " + what);
+            }
+        }
+    }
+
+    // Phase 1: drain everything that is left
+    g_state->drain_acks.fetch_add(1);
+    while (g_state->phase.load() == PHASE_DRAIN) {
+        if (!try_receive(msqid, 0, last_seq)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    // Phase 2: block on an empty queue until it is removed; the receive must fail
+    g_state->blocked.fetch_add(1);
+    try {
+        MessageQueue::receiveMessage(msqid, 0, false);
+        fail("blocking receive returned a message from an empty queue");
+    } catch (const std::runtime_error&) {
+        // Expected: EIDRM (or EINVAL if the queue was already gone)
+    }
+}
+
+[[noreturn]] static void run_worker_process(const Config& cfg, int msqid, unsigned int proc) {
+    uint32_t total_workers = cfg.processes * cfg.threads;
+    std::vector<std::thread> threads;
+    for (unsigned int t = 0; t < cfg.threads; ++t) {
+        threads.emplace_back(run_worker_thread, std::cref(cfg), msqid, proc * cfg.threads + t, total_workers);
+    }
+    for (std::thread& t : threads) t.join();
+    _exit(0);
+}
+
+// Wait until pred() holds or timeout_ms passes
+template <typename Pred>
+static bool wait_for(Pred pred, unsigned int timeout_ms) {
+    auto deadline = Clock::now() + std::chrono::milliseconds(timeout_ms);
+    while (!pred()) {
+        if (Clock::now() >= deadline) return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+// Reap the worker processes; every one must exit cleanly soon after the queue is removed
+static bool wait_workers(const std::vector<pid_t>& pids) {
+    bool all_exited = true;
+    for (pid_t pid : pids) {
+        int status = 0;
+        bool exited = wait_for([&] { return waitpid(pid, &status, WNOHANG) == pid; }, 5000);
+        if (!exited) {
+            fail("worker process hung after queue removal");
+            kill(pid, SIGKILL);
+            waitpid(pid, &status, 0);
+            all_exited = false;
+        } else if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            fail("worker process exited abnormally (status " + std::to_string(status) + ")");
+        }
+    }
+    return all_exited;
+}
+
+static bool run_round(const Config& cfg, unsigned int round) {
+    SharedState *st = g_state;
+    st->phase.store(PHASE_CHURN);
+    st->drain_acks.store(0);
+    st->blocked.store(0);
+    st->removed.store(0);
+    uint64_t sent_before = st->sent.load();
+    uint64_t received_before = st->received.load();
+    uint32_t total_workers = cfg.processes * cfg.threads;
+
+    size_t queue_bytes = 8 * cfg.max_size;
+    int msqid = -1;
+    try {
+        msqid = MessageQueue::create(IPC_PRIVATE, queue_bytes).getMsqid();
+    } catch (const std::exception& e) {
+        fail(std::string("create: ") + e.what());
+        return false;
+    }
+
+    std::vector<pid_t> pids;
+    for (unsigned int p = 0; p < cfg.processes; ++p) {
+        pid_t pid = fork();
+        if (pid == -1) {
+            fail("fork failed");
+            break;
+        }
+        if (pid == 0) {
+            Config child_cfg = cfg;
+            child_cfg.seed = cfg.seed + round * 7919;
+            run_worker_process(child_cfg, msqid, p);
+        }
+        pids.push_back(pid);
+    }
+
+    // Every other round on average, remove the queue at a random point of the churn instead
+    // of after the drain, so sends, receives and resizes are in flight when it disappears
+    std::mt19937_64 rng(cfg.seed + round * 7919);
+    if (rng() % 2) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(rng() % cfg.round_ms));
+        st->removed.store(1);
+        try {
+            MessageQueue::remove(msqid);
+        } catch (const std::exception& e) {
+            fail(std::string("remove: ") + e.what());
+        }
+        st->live_removals.fetch_add(1);
+        st->phase.store(PHASE_BLOCK);
+        return wait_workers(pids);
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(cfg.round_ms));
+
+    // Drain: every thread stops sending, then the queue must empty out with nothing lost
+    st->phase.store(PHASE_DRAIN);
+    bool ok = wait_for([&] { return st->drain_acks.load() == total_workers; }, 10000);
+    if (!ok) fail("workers did not stop sending");
+    ok = ok && wait_for([&] {
+        return MessageQueue::getInfo(msqid).num_messages == 0
+            && st->received.load() - received_before == st->sent.load() - sent_before;
+    }, 10000);
+    if (!ok) {
+        fail("round " + std::to_string(round) + ": sent " + std::to_string(st->sent.load() - sent_before)
+             + " but received " + std::to_string(st->received.load() - received_before));
+    }
+
+    // Remove the queue while every worker is blocked in msgrcv
+    st->phase.store(PHASE_BLOCK);
+    if (!wait_for([&] { return st->blocked.load() == total_workers; }, 10000)) fail("workers did not block");
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    try {
+        MessageQueue::remove(msqid);
+    } catch (const std::exception& e) {
+        fail(std::string("remove: ") + e.what());
+    }
+    return wait_workers(pids) && ok;
+}
+
+int main(int argc, char* argv[]) {
+    Config cfg;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        uint64_t n = 0;
+        bool ok = true;
+        if (arg == "--no-resize") {
+            cfg.resize = false;
+        } else if (arg == "--help" || arg == "-h") {
+            print_usage();
+            return 0;
+        } else if (i + 1 < argc) {
+            ok = parse_uint64(argv[++i], n);
+            if (arg == "--processes") { ok = ok && n > 0 && n <= 64; cfg.processes = static_cast<unsigned int>(n); }
+            else if (arg == "--threads") { ok = ok && n > 0 && n <= 64; cfg.threads = static_cast<unsigned int>(n); }
+            else if (arg == "--rounds") { ok = ok && n > 0; cfg.rounds = static_cast<unsigned int>(n); }
+            else if (arg == "--round-ms") { ok = ok && n > 0; cfg.round_ms = static_cast<unsigned int>(n); }
+            else if (arg == "--max-size") { ok = ok && n >= sizeof(PayloadHeader) && n <= 4096; cfg.max_size = n; }
+            else if (arg == "--seed") { cfg.seed = n; }
+            else ok = false;
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            std::cerr << "Error: Invalid option or value '" << arg << "'.\n";
+            print_usage();
+            return 1;
+        }
+    }
+
+    void *mem = mmap(nullptr, sizeof(SharedState), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+        std::cerr << "Failed to map shared state: " << strerror(errno) << "\n";
+        return 1;
+    }
+    g_state = new (mem) SharedState();
+
+    auto start = Clock::now();
+    for (unsigned int round = 0; round < cfg.rounds; ++round) {
+        if (!run_round(cfg, round)) break;
+    }
+    double elapsed_s = std::chrono::duration<double>(Clock::now() - start).count();
+
+    SharedState *st = g_state;
+    bool passed = st->failures.load() == 0;
+    std::cout << "Stress test " << (passed ? "passed" : "FAILED") << "!\n";
+    std::cout << "  workers        : " << cfg.processes << " process(es) x " << cfg.threads << " thread(s)\n";
+    std::cout << "  rounds         : " << cfg.rounds << " (" << elapsed_s << " s)\n";
+    std::cout << "  sent           : " << st->sent.load() << " (" << st->sent_bytes.load() << " bytes)\n";
+    std::cout << "  received       : " << st->received.load() << " (" << st->received_bytes.load() << " bytes)\n";
+    std::cout << "  queue full     : " << st->queue_full.load() << "\n";
+    std::cout << "  resizes        : " << st->resizes.load() << " (" << st->resize_races.load() << " send/resize races)\n";
+    std::cout << "  oversize       : " << st->oversize_sends.load() << " send(s) over msg_qbytes\n";
+    std::cout << "  live removals  : " << st->live_removals.load() << " of " << cfg.rounds << " round(s)\n";
+    std::cout << "  failures       : " << st->failures.load() << "\n";
+    if (!passed) {
+        std::cout << "  first failure  : " << st->first_error << "\n";
+    }
+
+    munmap(mem, sizeof(SharedState));
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,294 @@
+#include "sharded_queue.hpp"
+#include "ipc_internal.hpp"
+
+#include <sys/ipc.h>
+#include <sys/msg.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <unistd.h>
+#include <sched.h>
+#include <ctime>
+#include <cstring>
+#include <cerrno>
+#include <climits>
+#include <atomic>
+#include <limits>
+
+static const char SPEC_PREFIX[] = "shard:";
+
+// --- Doorbell ---
+
+static const uint32_t DOORBELL_MAGIC = 0x4442454c;  // "DBEL"
+
+// Safety net for messages sent without ringing the doorbell
+static const unsigned int DOORBELL_WAIT_MS = 100;
+
+struct DoorbellHeader {
+    ShmSegmentHeader segment;        // No slots
+    std::atomic<uint32_t> seq;       // Futex word, bumped by every send
+    std::atomic<uint32_t> sleepers;  // Receivers currently waiting on seq
+};
+
+static DoorbellHeader *doorbell_of(void *addr) {
+    return static_cast<DoorbellHeader *>(addr);
+}
+
+// The futex is shared between processes, so the non-private operations are used
+static void futex_wait(std::atomic<uint32_t> *word, uint32_t expected, unsigned int timeout_ms) {
+    struct timespec ts;
+    ts.tv_sec = timeout_ms / 1000;
+    ts.tv_nsec = static_cast<long>(timeout_ms % 1000) * 1000000L;
+    // EAGAIN (word already changed), EINTR and ETIMEDOUT all just mean "sweep again"
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(word), FUTEX_WAIT, expected, &ts, nullptr, 0);
+}
+
+static void futex_wake_all(std::atomic<uint32_t> *word) {
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+
+// Attach to the doorbell of the channel whose first shard is msqid, creating it if needed.
+// Everyone who may read or write the first shard may ring and wait on the doorbell.
+static void *open_doorbell(key_t base_key, int msqid, int &shmid) {
+    struct msqid_ds buf;
+    if (msgctl(msqid, IPC_STAT, &buf) == -1) {
+        throw std::runtime_error("Failed to get shard 0 info: " + std::string(strerror(errno)));
+    }
+    unsigned short mode = buf.msg_perm.mode & 0666;
+    unsigned short permissions = (mode | ((mode & 0444) >> 1) | ((mode & 0222) << 1)) & 0666;
+
+    void *addr = createSegment(base_key, sizeof(DoorbellHeader), permissions, "channel doorbell", shmid);
+    if (addr) {
+        publishSegment(addr, DOORBELL_MAGIC, 0);
+        return addr;
+    }
+    uint64_t num_slots;
+    return attachSegment(base_key, DOORBELL_MAGIC, sizeof(DoorbellHeader), 0, "channel doorbell", shmid, num_slots);
+}
+
+// Check that base_key .. base_key + num_shards - 1 neither overflows key_t nor reaches IPC_PRIVATE
+static void check_key_range(key_t base_key, size_t num_shards) {
+    if (num_shards == 0) throw std::invalid_argument("Number of shards must be positive");
+    if (base_key == IPC_PRIVATE) throw std::invalid_argument("Sharded channels need a non-private base key");
+
+    const long long key_max = std::numeric_limits<key_t>::max();
+    if (num_shards > static_cast<unsigned long long>(key_max)
+        || static_cast<long long>(base_key) + static_cast<long long>(num_shards - 1) > key_max
+        || (base_key < 0 && static_cast<long long>(base_key) + static_cast<long long>(num_shards - 1) >= 0)) {
+        throw std::invalid_argument("Shard keys starting at " + std::to_string(base_key) + " for "
+                                    + std::to_string(num_shards) + " shards overflow or reach IPC_PRIVATE");
+    }
+}
+
+// --- Static section ---
+ShardedQueue ShardedQueue::create(key_t base_key, size_t num_shards, size_t max_bytes, unsigned short permissions) {
+    check_key_range(base_key, num_shards);
+
+    std::vector<int> msqids;
+    try {
+        for (size_t i = 0; i < num_shards; ++i) {
+            msqids.push_back(MessageQueue::create(base_key + static_cast<key_t>(i), max_bytes, permissions).getMsqid());
+        }
+        int shmid;
+        void *doorbell = open_doorbell(base_key, msqids[0], shmid);
+        return ShardedQueue(std::move(msqids), shmid, doorbell);
+    } catch (...) {
+        for (int msqid : msqids) {
+            msgctl(msqid, IPC_RMID, nullptr);
+        }
+        throw;
+    }
+}
+
+ShardedQueue ShardedQueue::attach(key_t base_key, size_t num_shards) {
+    check_key_range(base_key, num_shards);
+
+    std::vector<int> msqids;
+    for (size_t i = 0; i < num_shards; ++i) {
+        key_t key = base_key + static_cast<key_t>(i);
+        int msqid = msgget(key, 0);
+        if (msqid == -1) {
+            throw std::runtime_error("Failed to attach to shard " + std::to_string(i) + " (key " + std::to_string(key)
+                                     + "): " + std::string(strerror(errno)));
+        }
+        msqids.push_back(msqid);
+    }
+    int shmid;
+    void *doorbell = open_doorbell(base_key, msqids[0], shmid);
+    return ShardedQueue(std::move(msqids), shmid, doorbell);
+}
+
+ShardedQueue ShardedQueue::attach(const std::string &spec) {
+    key_t base_key;
+    size_t num_shards;
+    if (!parseSpec(spec, base_key, num_shards)) {
+        throw std::invalid_argument("Invalid sharded channel spec '" + spec + "' (expected shard:<base_key>:<count>)");
+    }
+    return attach(base_key, num_shards);
+}
+
+bool ShardedQueue::isSpec(const std::string &s) {
+    return s.compare(0, sizeof(SPEC_PREFIX) - 1, SPEC_PREFIX) == 0;
+}
+
+bool ShardedQueue::parseSpec(const std::string &spec, key_t &base_key, size_t &num_shards) {
+    if (!isSpec(spec)) return false;
+    std::string rest = spec.substr(sizeof(SPEC_PREFIX) - 1);
+    size_t colon = rest.find(':');
+    if (colon == std::string::npos) return false;
+    try {
+        size_t idx;
+        std::string key_str = rest.substr(0, colon);
+        long key = std::stol(key_str, &idx, 0);
+        const long key_max = std::numeric_limits<key_t>::max();
+        if (idx != key_str.size() || key <= 0 || key > key_max) return false;
+
+        std::string count_str = rest.substr(colon + 1);
+        unsigned long count = std::stoul(count_str, &idx, 0);
+        if (idx != count_str.size() || count == 0 || count > 1024 || count_str[0] == '-') return false;
+        // Every shard key must stay a positive key_t: no wrap-around onto IPC_PRIVATE
+        if (key > key_max - static_cast<long>(count - 1)) return false;
+
+        base_key = static_cast<key_t>(key);
+        num_shards = count;
+        return true;
+    } catch (...) {
+        return false;
+    }
+}
+
+std::string ShardedQueue::makeSpec(key_t base_key, size_t num_shards) {
+    return SPEC_PREFIX + std::to_string(base_key) + ":" + std::to_string(num_shards);
+}
+
+// --- Object section ---
+ShardedQueue::ShardedQueue(std::vector<int> msqids, int doorbell_shmid, void *doorbell)
+    : msqids_(std::move(msqids)), doorbell_shmid_(doorbell_shmid), doorbell_(doorbell)
+{}
+
+ShardedQueue::~ShardedQueue() {
+    detachSegment(doorbell_);
+}
+
+ShardedQueue::ShardedQueue(ShardedQueue&& other) noexcept
+    : msqids_(std::move(other.msqids_)), doorbell_shmid_(other.doorbell_shmid_), doorbell_(other.doorbell_)
+{
+    other.doorbell_ = nullptr;
+}
+
+ShardedQueue& ShardedQueue::operator=(ShardedQueue&& other) noexcept {
+    if (this != &other) {
+        detachSegment(doorbell_);
+        msqids_ = std::move(other.msqids_);
+        doorbell_shmid_ = other.doorbell_shmid_;
+        doorbell_ = other.doorbell_;
+        other.doorbell_ = nullptr;
+    }
+    return *this;
+}
+
+size_t ShardedQueue::shardForKey(uint64_t routing_key) const {
+    return mix64(routing_key) % msqids_.size();
+}
+
+size_t ShardedQueue::shardForCpu() const {
+    int cpu = sched_getcpu();
+    return cpu < 0 ? 0 : static_cast<size_t>(cpu) % msqids_.size();
+}
+
+void ShardedQueue::sendMessage(long type, const std::string &message, uint64_t routing_key) {
+    MessageQueue::sendMessage(msqids_[shardForKey(routing_key)], type, message);
+    wakeReceivers();
+}
+
+void ShardedQueue::sendMessage(long type, const std::string &message) {
+    MessageQueue::sendMessage(msqids_[shardForCpu()], type, message);
+    wakeReceivers();
+}
+
+bool ShardedQueue::trySendMessage(long type, const std::string &message, uint64_t routing_key) {
+    if (!MessageQueue::trySendMessage(msqids_[shardForKey(routing_key)], type, message)) return false;
+    wakeReceivers();
+    return true;
+}
+
+bool ShardedQueue::trySendMessage(long type, const std::string &message) {
+    if (!MessageQueue::trySendMessage(msqids_[shardForCpu()], type, message)) return false;
+    wakeReceivers();
+    return true;
+}
+
+void ShardedQueue::wakeReceivers() {
+    // The bump is ordered before the sleeper check, and a receiver registers as a sleeper before
+    // it waits on the value it read before its sweep: either this sender sees the sleeper and
+    // wakes it, or the receiver sees the new value and does not go to sleep.
+    DoorbellHeader *hdr = doorbell_of(doorbell_);
+    hdr->seq.fetch_add(1);
+    if (hdr->sleepers.load() > 0) futex_wake_all(&hdr->seq);
+}
+
+bool ShardedQueue::tryReceiveMessage(long type, size_t home_shard, std::string &message) {
+    size_t n = msqids_.size();
+    for (size_t i = 0; i < n; ++i) {
+        if (MessageQueue::tryReceiveMessage(msqids_[(home_shard + i) % n], type, message)) return true;
+    }
+    return false;
+}
+
+std::string ShardedQueue::receiveMessage(long type, size_t home_shard, bool nowait) {
+    std::string message;
+    if (tryReceiveMessage(type, home_shard, message)) return message;
+    if (nowait) throw std::runtime_error("No message of the requested type in any shard.");
+
+    size_t n = msqids_.size();
+    if (n == 1) return MessageQueue::receiveMessage(msqids_[0], type);
+
+    // System V has no way to wait on several queues at once, and blocking on the home shard
+    // alone would strand messages on shards nobody is homed on. So the receiver sleeps on the
+    // doorbell and sweeps every shard each time a sender rings it. All sleepers are woken
+    // because they may be waiting for different message types.
+    DoorbellHeader *hdr = doorbell_of(doorbell_);
+    for (;;) {
+        uint32_t seq = hdr->seq.load();
+        if (tryReceiveMessage(type, home_shard, message)) return message;
+        hdr->sleepers.fetch_add(1);
+        futex_wait(&hdr->seq, seq, DOORBELL_WAIT_MS);
+        hdr->sleepers.fetch_sub(1);
+    }
+}
+
+std::string ShardedQueue::receiveMessage(long type, bool nowait) {
+    return receiveMessage(type, shardForCpu(), nowait);
+}
+
+void ShardedQueue::setMaxBytes(size_t max_bytes) {
+    for (int msqid : msqids_) {
+        MessageQueue::setMaxBytes(msqid, max_bytes);
+    }
+}
+
+void ShardedQueue::remove() {
+    std::string errors;
+    for (int msqid : msqids_) {
+        try {
+            MessageQueue::remove(msqid);
+        } catch (const std::exception& e) {
+            errors += (errors.empty() ? "" : "; ") + std::string("msqid ") + std::to_string(msqid) + ": " + e.what();
+        }
+    }
+    // Blocked receivers wake up, find the shards gone and fail
+    wakeReceivers();
+    try {
+        removeSegment(doorbell_shmid_, "channel doorbell");
+    } catch (const std::exception& e) {
+        errors += (errors.empty() ? "" : "; ") + std::string(e.what());
+    }
+    if (!errors.empty()) throw std::runtime_error(errors);
+}
+
+std::vector<QueueInfo> ShardedQueue::getInfo() const {
+    std::vector<QueueInfo> infos;
+    for (int msqid : msqids_) {
+        infos.push_back(MessageQueue::getInfo(msqid));
+    }
+    return infos;
+}
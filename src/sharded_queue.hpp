@@ -0,0 +1,130 @@
+#pragma once
+
+#include "message_queue.hpp"
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <stdexcept>
+#include <sys/types.h>
+
+// One logical channel spread over K System V queues ("shards").
+// A single queue is serialized by one kernel lock; spreading traffic over several queues
+// spreads that contention when producers and consumers run on several cores.
+//
+// Shards use consecutive keys base_key .. base_key + K - 1, so a channel is fully described
+// by the spec string "shard:<base_key>:<K>", which the CLI utilities accept in place of a msqid.
+// Producers pick a shard by routing key hash or by current CPU. Consumers read their home
+// shard first and steal from the other shards when it is empty. Ordering is only preserved
+// per shard, i.e. per routing key.
+//
+// System V cannot wait on several queues at once, so every channel also has a "doorbell": a
+// small shared memory segment with System V key base_key holding a futex word. Every send
+// through ShardedQueue rings it, and blocking receivers on a multi-shard channel sleep on it.
+class ShardedQueue {
+public:
+    // Create num_shards queues with keys base_key .. base_key + num_shards - 1, plus the
+    // channel's doorbell. Shards created before a failure are removed again.
+    // Throws std::invalid_argument if the key range overflows key_t or includes IPC_PRIVATE,
+    // std::runtime_error on failure
+    static ShardedQueue create(key_t base_key, size_t num_shards, size_t max_bytes, unsigned short permissions = 0600);
+
+    // Attach to the existing shards with keys base_key .. base_key + num_shards - 1.
+    // Creates the doorbell if it is missing, with the permissions of the first shard.
+    // Throws std::invalid_argument if the key range overflows key_t or includes IPC_PRIVATE,
+    // std::runtime_error on failure
+    static ShardedQueue attach(key_t base_key, size_t num_shards);
+
+    // Attach to a channel given as "shard:<base_key>:<num_shards>"
+    // Throws std::invalid_argument on a malformed spec, std::runtime_error on failure
+    static ShardedQueue attach(const std::string &spec);
+
+    // Check whether a string looks like a sharded-channel spec (starts with "shard:")
+    static bool isSpec(const std::string &s);
+
+    // Parse "shard:<base_key>:<num_shards>". Returns false on malformed input, including a base
+    // key outside 1 .. INT_MAX or a range whose last key would overflow
+    static bool parseSpec(const std::string &spec, key_t &base_key, size_t &num_shards);
+
+    // Format a sharded-channel spec
+    static std::string makeSpec(key_t base_key, size_t num_shards);
+
+    // Shard chosen for a routing key (stable hash)
+    size_t shardForKey(uint64_t routing_key) const;
+
+    // Shard chosen for the CPU the caller is running on
+    size_t shardForCpu() const;
+
+    // Send to the shard of routing_key (messages with equal keys stay ordered)
+    // Throws std::runtime_error on failure
+    void sendMessage(long type, const std::string &message, uint64_t routing_key);
+
+    // Send to the shard of the current CPU
+    // Throws std::runtime_error on failure
+    void sendMessage(long type, const std::string &message);
+
+    // Send to the shard of routing_key without throwing when it is full (returns false on EAGAIN)
+    // Throws std::runtime_error on any other failure
+    bool trySendMessage(long type, const std::string &message, uint64_t routing_key);
+
+    // Send to the shard of the current CPU without throwing when it is full (returns false on EAGAIN)
+    // Throws std::runtime_error on any other failure
+    bool trySendMessage(long type, const std::string &message);
+
+    // Wake blocked receivers after sending to a shard's msqid directly instead of through
+    // sendMessage or trySendMessage
+    void wakeReceivers();
+
+    // Receive from home_shard, stealing from the other shards when it is empty.
+    // When every shard is empty, either returns false (tryReceiveMessage), throws (nowait),
+    // or waits (blocking): a single-shard channel blocks in msgrcv, otherwise the caller sleeps
+    // on the doorbell and sweeps all shards again whenever it rings. Messages sent without
+    // ringing it (by other System V programs) are still picked up within 100 ms.
+    // Throws std::runtime_error on failure or if no message is present in non-blocking mode.
+    std::string receiveMessage(long type, size_t home_shard, bool nowait = false);
+
+    // Receive with the current CPU's shard as home shard
+    // Throws std::runtime_error on failure or if no message is present in non-blocking mode.
+    std::string receiveMessage(long type, bool nowait = false);
+
+    // Receive from home_shard or steal from another shard; returns false if all are empty
+    // Throws std::runtime_error on failure
+    bool tryReceiveMessage(long type, size_t home_shard, std::string &message);
+
+    // Change maximum allowed bytes of every shard
+    // Throws std::runtime_error on failure
+    void setMaxBytes(size_t max_bytes);
+
+    // Remove (delete) every shard and the doorbell from the system, waking blocked receivers.
+    // Attempts everything before reporting a failure.
+    // Throws std::runtime_error on failure
+    void remove();
+
+    // Get detailed info for every shard
+    // Throws std::runtime_error on failure
+    std::vector<QueueInfo> getInfo() const;
+
+    // Get number of shards
+    size_t getNumShards() const { return msqids_.size(); }
+
+    // Get underlying msqids, indexed by shard
+    const std::vector<int> &getMsqids() const { return msqids_; }
+
+    // Destructor: detaches from the doorbell
+    ~ShardedQueue();
+
+    // Deleted copy operations
+    ShardedQueue(const ShardedQueue&) = delete;
+    ShardedQueue& operator=(const ShardedQueue&) = delete;
+
+    // Allowed move operations
+    ShardedQueue(ShardedQueue&& other) noexcept;
+    ShardedQueue& operator=(ShardedQueue&& other) noexcept;
+
+private:
+    ShardedQueue(std::vector<int> msqids, int doorbell_shmid, void *doorbell);
+
+    std::vector<int> msqids_;
+    int doorbell_shmid_;   // Shared memory ID of the doorbell segment
+    void *doorbell_;       // Attached doorbell (nullptr after a move)
+};